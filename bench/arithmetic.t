@@ -0,0 +1,19 @@
+u8 nl[] = "\n";
+i32 a = 7;
+i32 b = 3;
+i32 c = 0;
+f32 f = 1.5;
+f32 g = 0.0;
+
+for (i32 k : 1..=200) {
+    c = c + (a * k - b) / 4 + k * k;
+    g = g + f * k / 3.0 - 0.25 * k;
+    a = a + 1;
+}
+
+print_str("c = ");
+print_i32(c);
+print_str(nl);
+print_str("g = ");
+print_f32(g);
+print_str(nl);
@@ -0,0 +1,12 @@
+u8 sep[] = " ";
+i32 values[4];
+i32 sum = 0;
+
+// the fifth iteration writes past the end of values
+for (i32 i : 0..5) {
+    values[i] = i * 3;
+    sum = sum + values[i];
+    print_i32(sum);
+    print_str(sep);
+}
+print_str("not reached");
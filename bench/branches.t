@@ -0,0 +1,46 @@
+u8 nl[] = "\n";
+i32 small = 0;
+i32 medium = 0;
+i32 large = 0;
+i32 odd = 0;
+f32 fsum = 0.0;
+
+for (i32 v : 0..300) {
+    if (v < 100) {
+        small = small + 1;
+        if (v < 50) {
+            if (v < 25) {
+                fsum = fsum + 0.5;
+            } else {
+                fsum = fsum + 0.25;
+            }
+        } else {
+            fsum = fsum - 0.125;
+        }
+    } else {
+        if (v < 200) {
+            medium = medium + 1;
+            if (v != 150) {
+                odd = odd + v / 7;
+            }
+        } else {
+            large = large + 1;
+            if (v > 250) {
+                odd = odd - 1;
+            } else {
+                odd = odd + 2;
+            }
+        }
+    }
+}
+
+print_i32(small);
+print_str(" ");
+print_i32(medium);
+print_str(" ");
+print_i32(large);
+print_str(" ");
+print_i32(odd);
+print_str(" ");
+print_f32(fsum);
+print_str(nl);
@@ -0,0 +1,23 @@
+u8 nl[] = "\n";
+f32 cube[8, 8, 8];
+f32 acc = 0.0;
+
+for (i32 x : 0..8) {
+    for (i32 y : 0..8) {
+        for (i32 z : 0..8) {
+            cube[x, y, z] = x * 0.5 + y * 0.25 + z;
+        }
+    }
+}
+
+for (i32 x2 : 0..8) {
+    for (i32 y2 : 0..8) {
+        for (i32 z2 : 0..8) {
+            acc = acc + cube[x2, y2, z2] * 0.125;
+        }
+    }
+}
+
+print_str("acc = ");
+print_f32(acc);
+print_str(nl);
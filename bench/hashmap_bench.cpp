@@ -0,0 +1,168 @@
+// Micro-benchmark of HashMap against the std::unordered_map wrapper it replaced, on symbol
+// table sized workloads: Symbol keys as used by Compiler::symbolTable and string keys looked
+// up through std::string_view as done by Interner.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "HashMap.hpp"
+#include "Interner.hpp"
+
+namespace {
+
+/// @brief The previous HashMap, a thin std::unordered_map wrapper keyed by full keys
+template<typename TKey, typename TValue>
+class NodeMap {
+public:
+    TValue &operator [] (const TKey &key) { return map[key]; }
+
+    std::optional<TValue*> find(const TKey &key) {
+        auto it = map.find(key);
+        if (it != map.end())
+            return &it->second;
+        return std::nullopt;
+    }
+
+    auto begin() { return map.begin(); }
+    auto end() { return map.end(); }
+
+private:
+    std::unordered_map<TKey, TValue> map;
+};
+
+/// @brief Same layout as SymbolInfo, without pulling in the register manager
+struct Info {
+    int type = 0;
+    bool temporary = false;
+    Symbol initial_value;
+    std::vector<int> array_dims;
+    std::vector<int> array_sizes;
+    bool initialized = false;
+    int occupied_reg = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+volatile std::size_t sink;
+
+template<typename F>
+double ns_per_op(std::size_t ops, F &&body) {
+    // Repeat until the measurement is long enough to be stable
+    std::size_t rounds = 1;
+    for (;;) {
+        auto start = Clock::now();
+        for (std::size_t r = 0; r < rounds; r++)
+            body();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (ns > 2e7)
+            return ns / double(rounds * ops);
+        rounds *= 2;
+    }
+}
+
+struct Result {
+    double insert, hit, miss, iterate;
+};
+
+/// @brief names shaped like the compiler's: user identifiers and generated temporaries
+std::vector<std::string> make_names(std::size_t count, const char *prefix, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::string> names;
+    for (std::size_t i = 0; i < count; i++) {
+        if (i % 3 == 0)
+            names.push_back("__tmp_result_" + std::to_string(i));
+        else
+            names.push_back(std::string(prefix) + "var" + std::to_string(rng() % 100000) + "_" + std::to_string(i));
+    }
+    return names;
+}
+
+template<typename TMap, typename TKey, typename TLookup>
+Result run(const std::vector<TKey> &keys, const std::vector<TLookup> &hits, const std::vector<TLookup> &misses) {
+    Result result{};
+    result.insert = ns_per_op(keys.size(), [&] {
+        TMap map;
+        for (auto &key: keys)
+            map[key].initialized = true;
+        sink = sink + std::size_t(&map[keys[0]] != nullptr);
+    });
+
+    TMap map;
+    for (auto &key: keys)
+        map[key].initialized = true;
+    result.hit = ns_per_op(hits.size(), [&] {
+        std::size_t found = 0;
+        for (auto &key: hits)
+            found += map.find(key).has_value();
+        sink = sink + found;
+    });
+    result.miss = ns_per_op(misses.size(), [&] {
+        std::size_t found = 0;
+        for (auto &key: misses)
+            found += map.find(key).has_value();
+        sink = sink + found;
+    });
+    result.iterate = ns_per_op(keys.size(), [&] {
+        std::size_t count = 0;
+        for (auto &entry: map)
+            count += entry.second.initialized;
+        sink = sink + count;
+    });
+    return result;
+}
+
+void print(const char *workload, std::size_t size, const char *map, const Result &r) {
+    std::printf("%-18s %6zu  %-14s %8.1f %8.1f %8.1f %8.1f\n", workload, size, map, r.insert, r.hit, r.miss, r.iterate);
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::size_t> sizes = {16, 128, 1024, 8192};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++)
+            sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+
+    std::printf("%-18s %6s  %-14s %8s %8s %8s %8s   (ns/op)\n", "workload", "size", "map", "insert", "hit", "miss", "iterate");
+    for (std::size_t size: sizes) {
+        auto names = make_names(size, "", 1);
+        auto absent = make_names(size, "x", 2);
+        std::vector<std::string> hit_names;
+        std::mt19937 rng(3);
+        for (std::size_t i = 0; i < 4 * size; i++)
+            hit_names.push_back(names[rng() % size]);
+
+        // Symbol keys, hashing and comparing ids
+        Interner interner;
+        std::vector<Symbol> symbols, hit_symbols, miss_symbols;
+        for (auto &name: names)
+            symbols.push_back(interner.intern(name));
+        for (auto &name: hit_names)
+            hit_symbols.push_back(interner.intern(name));
+        for (auto &name: absent)
+            miss_symbols.push_back(interner.intern(name));
+        print("symbol keys", size, "unordered_map",
+              run<NodeMap<Symbol, Info>>(symbols, hit_symbols, miss_symbols));
+        print("symbol keys", size, "HashMap",
+              run<HashMap<Symbol, Info>>(symbols, hit_symbols, miss_symbols));
+
+        // String keys queried with views into source text; the wrapper needs a std::string per lookup
+        std::vector<std::string_view> hit_views(hit_names.begin(), hit_names.end());
+        std::vector<std::string_view> miss_views(absent.begin(), absent.end());
+        struct StringNodeMap : NodeMap<std::string, Info> {
+            std::optional<Info*> find(std::string_view key) { return NodeMap::find(std::string(key)); }
+        };
+        print("string_view keys", size, "unordered_map",
+              run<StringNodeMap>(names, hit_views, miss_views));
+        print("string_view keys", size, "HashMap",
+              run<HashMap<std::string, Info>>(names, hit_views, miss_views));
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Scanner throughput on a generated multi-hundred-MiB source: read through an ifstream and copied
+// into a buffer of the scanner as the driver did before, against mapped and scanned in place.
+// Only the scanner runs, identifiers and literals are interned as when parsing.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "Compiler.hpp"
+#include "MappedFile.hpp"
+#include "Parser.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// @brief Writes at least mib MiB of statements with the token mix of the test programs
+/// @return size of the file in bytes
+std::size_t write_source(const std::string &path, std::size_t mib) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+        std::exit(1);
+    }
+    std::string chunk;
+    for (int i = 0; chunk.size() < (1 << 20); i++) {
+        std::string name = "value_" + std::to_string(i % 997);
+        chunk += "i32 " + name + " = " + std::to_string(i) + " * (count_" + std::to_string(i % 31) + " + 7);\n";
+        chunk += "f32 ratio_" + std::to_string(i % 101) + " = 3.25 / 1.5 - " + name + ";\n";
+        chunk += "for i in 0..10 {\n    if " + name + " >= 3 { print_i32(" + name + "[i, 2]); }\n}\n";
+        chunk += "print_str(\"step " + std::to_string(i % 13) + " done\"); // progress\n";
+    }
+    std::size_t written = 0;
+    for (; written < mib << 20; written += chunk.size())
+        file << chunk;
+    return written;
+}
+
+struct Result {
+    double seconds;
+    std::size_t tokens;
+};
+
+/// @brief What parse_program(std::string_view) costs on top of scanning: the istreambuf_iterator
+/// read of the driver and the copy yy_scan_bytes makes
+Result scan_copied(const std::string &path) {
+    auto start = Clock::now();
+    std::ifstream file(path, std::ios::binary);
+    std::string source(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>{});
+    std::string buffer;
+    buffer.reserve(source.size() + 2);
+    buffer.append(source).append(2, '\0');
+    auto compiler = std::make_unique<Compiler>();
+    std::size_t tokens = scan_tokens({buffer.data(), source.size()}, *compiler);
+    return {std::chrono::duration<double>(Clock::now() - start).count(), tokens};
+}
+
+Result scan_mapped(const std::string &path) {
+    auto start = Clock::now();
+    MappedFile file(path);
+    auto compiler = std::make_unique<Compiler>();
+    std::size_t tokens = scan_tokens({file.data(), file.size()}, *compiler);
+    return {std::chrono::duration<double>(Clock::now() - start).count(), tokens};
+}
+
+}
+
+int main(int argc, char **argv) {
+    std::size_t mib = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    std::string path = argc > 2 ? argv[2] : "lex_bench_input.t";
+    double size_mib = double(write_source(path, mib)) / (1 << 20);
+
+    // best of a few alternating rounds, the file stays in the page cache after writing it
+    Result copied{1e30, 0}, mapped{1e30, 0};
+    for (int round = 0; round < 3; round++) {
+        auto c = scan_copied(path);
+        auto m = scan_mapped(path);
+        if (c.seconds < copied.seconds)
+            copied = c;
+        if (m.seconds < mapped.seconds)
+            mapped = m;
+    }
+    std::remove(path.c_str());
+
+    std::printf("%-16s %10s %12s %10s\n", "input", "MiB/s", "tokens", "seconds");
+    for (auto &[name, r]: {std::pair{"read + copy", copied}, std::pair{"mapped in place", mapped}})
+        std::printf("%-16s %10.1f %12zu %10.3f\n", name, size_mib / r.seconds, r.tokens, r.seconds);
+    return copied.tokens == mapped.tokens ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+u8 nl[] = "\n";
+i32 aq[4, 5];
+f32 farr[2, 8];
+i32 s = 0;
+f32 fs = 0.0;
+aq[1, 3] = 6;
+for (i32 i : 0..aq[1, 3]) {
+    for (i32 j : 0..8) {
+        fs = fs + farr[1, j] + 1.5;
+        s = s + aq[1, 3];
+    }
+}
+print_i32(s);
+print_str(" ");
+print_f32(fs);
+print_str(nl);
@@ -0,0 +1,36 @@
+u8 nl[] = "\n";
+u8 sep[] = " ";
+i32 x3 = 5;
+f32 f5 = 1.5;
+f32 acc = 0.0;
+
+// every f32 * i32 operand pair converts the i32 side to a fresh $f register
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(f5 * x3);
+print_str(sep);
+print_f32(x3 + f5 - x3 * f5 + f5 / x3);
+print_str(nl);
+
+for (i32 k : 1..=40) {
+    acc = acc + f5 * k - k / 2 + x3 * 0.5;
+    if (acc > k * 20) {
+        acc = acc - f5 * x3;
+    }
+}
+print_f32(acc);
+print_str(nl);
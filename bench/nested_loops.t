@@ -0,0 +1,21 @@
+u8 nl[] = "\n";
+i32 grid[16, 16];
+i32 total = 0;
+
+for (i32 r : 0..16) {
+    for (i32 c : 0..16) {
+        grid[r, c] = r * 16 + c;
+    }
+}
+
+for (i32 rep : 0..4) {
+    for (i32 r2 : 0..16) {
+        for (i32 c2 : 0..16) {
+            total = total + grid[r2, c2];
+        }
+    }
+}
+
+print_str("total = ");
+print_i32(total);
+print_str(nl);
@@ -0,0 +1,18 @@
+u8 nl[] = "\n";
+u8 sep[] = ", ";
+
+for (i32 line : 0..20) {
+    print_str("line ");
+    print_i32(line);
+    print_str(": ");
+    for (i32 col : 0..10:2) {
+        print_str("[");
+        print_i32(col);
+        print_str(sep);
+        print_i32(line * col);
+        print_str("] = ");
+        print_str("value");
+        print_str(sep);
+    }
+    print_str(nl);
+}
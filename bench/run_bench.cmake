@@ -0,0 +1,115 @@
+# Compiles every bench/*.t program, runs it in mips-sim and compares the
+# measurements with bench/baseline.txt.
+#
+#   cmake -DCOMPILER=<compiler> -DSIM=<mips-sim> -DBENCH_DIR=<bench> -DWORK_DIR=<dir>
+#         [-DOPT_LEVEL=2] [-DUPDATE_BASELINE=ON] [-DCOMPILER_FLAGS="..."] [-DREPORT_ONLY=ON]
+#         -P run_bench.cmake
+#
+# Fails when a program produces different output than <name>.expected or when
+# any metric is larger than its baseline value. REPORT_ONLY prints the metrics
+# next to the baseline without failing, e.g. to see the cost of COMPILER_FLAGS.
+
+if(NOT OPT_LEVEL)
+    set(OPT_LEVEL 2)
+endif()
+separate_arguments(compiler_flags UNIX_COMMAND "${COMPILER_FLAGS}")
+
+# baseline key and the mips-sim --stats line it is read from
+set(METRICS
+        "static_instructions=text instructions"
+        "data_bytes=data bytes"
+        "instructions=instructions"
+        "loads=loads"
+        "stores=stores"
+        "branches_taken=branches taken"
+        "cycles=estimated cycles")
+set(BASELINE_FILE ${BENCH_DIR}/baseline.txt)
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# baseline lines: <program> <metric>=<value> ...
+if(EXISTS ${BASELINE_FILE})
+    file(STRINGS ${BASELINE_FILE} baseline_lines REGEX "^[^#]")
+    foreach(line IN LISTS baseline_lines)
+        string(REGEX MATCH "^[^ ]+" program "${line}")
+        string(REGEX MATCHALL "[a-z_]+=[0-9]+" pairs "${line}")
+        foreach(pair IN LISTS pairs)
+            string(REPLACE "=" ";" pair "${pair}")
+            list(GET pair 0 key)
+            list(GET pair 1 value)
+            set(baseline_${program}_${key} ${value})
+        endforeach()
+    endforeach()
+endif()
+
+file(GLOB programs ${BENCH_DIR}/*.t)
+list(SORT programs)
+
+set(failed FALSE)
+set(regression_level SEND_ERROR)
+if(UPDATE_BASELINE OR REPORT_ONLY)
+    set(regression_level STATUS)
+endif()
+set(new_baseline "# generated by the bench-update-baseline target (-O${OPT_LEVEL})\n")
+
+foreach(source IN LISTS programs)
+    get_filename_component(name ${source} NAME_WE)
+    set(asm ${WORK_DIR}/${name}.s)
+
+    execute_process(COMMAND ${COMPILER} -O${OPT_LEVEL} ${compiler_flags} ${asm}
+            INPUT_FILE ${source}
+            RESULT_VARIABLE result
+            ERROR_VARIABLE compile_errors)
+    if(NOT result EQUAL 0)
+        message(SEND_ERROR "${name}: compilation failed\n${compile_errors}")
+        set(failed TRUE)
+        continue()
+    endif()
+
+    execute_process(COMMAND ${SIM} --stats ${asm}
+            RESULT_VARIABLE result
+            OUTPUT_VARIABLE output
+            ERROR_VARIABLE stats)
+    if(NOT result EQUAL 0)
+        message(SEND_ERROR "${name}: simulation failed\n${stats}")
+        set(failed TRUE)
+        continue()
+    endif()
+
+    if(EXISTS ${BENCH_DIR}/${name}.expected)
+        file(READ ${BENCH_DIR}/${name}.expected expected)
+        if(NOT output STREQUAL expected)
+            message(SEND_ERROR "${name}: output differs from ${name}.expected\n${output}")
+            set(failed TRUE)
+        endif()
+    endif()
+
+    set(report "${name}:")
+    set(baseline_entry "${name}")
+    foreach(metric IN LISTS METRICS)
+        string(REGEX REPLACE "=.*" "" key "${metric}")
+        string(REGEX REPLACE ".*=" "" metric "${metric}")
+        string(REGEX MATCH "(^|\n)${metric}: *([0-9]+)" unused "${stats}")
+        set(value ${CMAKE_MATCH_2})
+        string(APPEND baseline_entry " ${key}=${value}")
+
+        if(DEFINED baseline_${name}_${key})
+            set(base ${baseline_${name}_${key}})
+            if(value GREATER base)
+                message(${regression_level} "${name}: ${metric} regressed ${base} -> ${value}")
+                set(failed TRUE)
+            endif()
+            string(APPEND report " ${key}=${value} (${base})")
+        else()
+            string(APPEND report " ${key}=${value} (new)")
+        endif()
+    endforeach()
+    message(STATUS "${report}")
+    string(APPEND new_baseline "${baseline_entry}\n")
+endforeach()
+
+if(UPDATE_BASELINE)
+    file(WRITE ${BASELINE_FILE} "${new_baseline}")
+    message(STATUS "baseline written to ${BASELINE_FILE}")
+elseif(failed AND NOT REPORT_ONLY)
+    message(FATAL_ERROR "benchmark regression, rerun with -DUPDATE_BASELINE=ON after an intended change")
+endif()
@@ -0,0 +1,16 @@
+u8 nl[] = "\n";
+u8 sep[] = " ";
+
+// arguments equal to the syscall code in $v0 must still be loaded into $a0
+print_i32(1);
+print_str(nl);
+print_i32(1 * 1);
+print_str(nl);
+print_i32(4);
+print_str(sep);
+print_str(nl);
+for (i32 i : 0..5) {
+    print_i32(i - 2);
+    print_str(sep);
+}
+print_str(nl);
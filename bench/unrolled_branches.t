@@ -0,0 +1,37 @@
+u8 nl[] = "\n";
+u8 sep[] = " ";
+i32 diagonal = 0;
+i32 below = 0;
+i32 above = 0;
+
+// both loops are unrolled, the copies of the inner body need labels of their own
+for (i32 i : 0..3) {
+    for (i32 j : 0..3) {
+        if (j == i) {
+            diagonal = diagonal + 1;
+        } else {
+            if (j < i) {
+                below = below + i * j;
+            } else {
+                above = above + j - i;
+            }
+        }
+    }
+}
+print_i32(diagonal);
+print_str(sep);
+print_i32(below);
+print_str(sep);
+print_i32(above);
+print_str(nl);
+
+i32 c = 0;
+for (i32 k : 0..2) {
+    for (i32 m : 0..2) {
+        if (m == k) {
+            c = c + 1;
+        }
+    }
+}
+print_i32(c);
+print_str(nl);
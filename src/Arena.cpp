@@ -0,0 +1,29 @@
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+Arena::Arena(std::size_t chunk_size) : chunk_size(chunk_size) {}
+
+void *Arena::allocate(std::size_t size, std::size_t align) {
+    auto aligned = (reinterpret_cast<std::uintptr_t>(cursor) + align - 1) & ~(std::uintptr_t(align) - 1);
+    if (cursor == nullptr || aligned + size > reinterpret_cast<std::uintptr_t>(chunk_end)) {
+        // oversized requests get a chunk of their own
+        std::size_t new_chunk_size = std::max(chunk_size, size + align);
+        chunks.emplace_back(new char[new_chunk_size]);
+        cursor = chunks.back().get();
+        chunk_end = cursor + new_chunk_size;
+        aligned = (reinterpret_cast<std::uintptr_t>(cursor) + align - 1) & ~(std::uintptr_t(align) - 1);
+    }
+    cursor = reinterpret_cast<char *>(aligned + size);
+    used += size;
+    return reinterpret_cast<void *>(aligned);
+}
+
+std::string_view Arena::copy(std::string_view text) {
+    auto *data = static_cast<char *>(allocate(text.size() + 1, 1));
+    std::memcpy(data, text.data(), text.size());
+    data[text.size()] = '\0';
+    return {data, text.size()};
+}
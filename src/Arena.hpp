@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/// @brief Bump allocator, memory is released all at once when the arena is destroyed
+class Arena {
+public:
+    explicit Arena(std::size_t chunk_size = 64 * 1024);
+
+    Arena(const Arena &) = delete;
+
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+    /// @return NUL terminated copy of the text owned by the arena
+    std::string_view copy(std::string_view text);
+
+    /// @return bytes handed out by allocate() and copy()
+    std::size_t bytes_used() const { return used; }
+
+    std::size_t chunk_count() const { return chunks.size(); }
+
+private:
+    std::vector<std::unique_ptr<char[]>> chunks;
+    std::size_t chunk_size;
+    char *cursor = nullptr;
+    char *chunk_end = nullptr;
+    std::size_t used = 0;
+};
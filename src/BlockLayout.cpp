@@ -0,0 +1,157 @@
+#include "BlockLayout.hpp"
+#include "LoopInfo.hpp"
+
+#include <algorithm>
+#include <optional>
+
+namespace passes {
+
+namespace {
+
+/// @brief Loop in the layout emitted for a for loop, the step block before the body:
+///     STEP:       ... bge r, BOUND, EXIT
+///     BODY...:    ... b STEP
+struct StepFirstLoop {
+    int step_block;
+    int last_body;
+};
+
+std::optional<StepFirstLoop> match_step_first(const ir::Program &program, const ir::Loop &loop) {
+    if (loop.latches.size() != 1)
+        return std::nullopt;
+    int step_block = loop.latches[0];
+    if (step_block == 0 || step_block + 1 != loop.header || program.blocks[step_block - 1].falls_through())
+        return std::nullopt;
+
+    int last_body = loop.header;
+    while (last_body + 1 < int(program.blocks.size()) && loop.contains(last_body + 1))
+        last_body++;
+    if (int(loop.blocks.size()) != last_body - step_block + 1)
+        return std::nullopt;
+
+    auto &step = program.blocks[step_block];
+    auto &body_end = program.blocks[last_body].instrs;
+    if (step.label.empty() || step.instrs.empty() || program.blocks[loop.header].label.empty())
+        return std::nullopt;
+    if (body_end.empty() || !body_end.back().is_jump() || body_end.back().target() != step.label)
+        return std::nullopt;
+
+    auto &test = step.instrs.back();
+    if (!test.is_branch() || ir::inverted_branch(test.opcode).empty())
+        return std::nullopt;
+    int exit = program.find_block(test.target());
+    if (exit >= 0 && loop.contains(exit))
+        return std::nullopt;
+    return StepFirstLoop{step_block, last_body};
+}
+
+/// @brief Moves the step block after the body, its test branches back to the body and the exit
+/// is the fall-through
+/// @return true if a loop was rotated
+bool rotate_one(ir::Program &program, PassStats &stats) {
+    ir::LoopInfo loop_info(program);
+    ir::Liveness liveness(program);
+    auto address_taken = ir::address_taken_symbols(program);
+    for (auto &loop: loop_info.loops()) {
+        auto shape = match_step_first(program, loop);
+        if (!shape)
+            continue;
+        int step_block = shape->step_block;
+        int last_body = shape->last_body;
+        const std::string &body_label = program.blocks[loop.header].label;
+        // a literal trip count is counted down in a free register, one compare with zero
+        auto counted = ir::match_counted_loop(program, loop, address_taken);
+        auto &step = program.blocks[step_block].instrs;
+        ir::Instr test = step.back();
+        step.pop_back();
+        std::string down_counter;
+        if (counted)
+            down_counter = ir::find_unused_register(program, loop, liveness.live_in(loop.header), "$t0");
+        if (!down_counter.empty()) {
+            auto &preheader = program.blocks[loop.preheader].instrs;
+            preheader.insert(preheader.end() - 1,
+                             ir::Instr("li", {down_counter, int(counted->trip_count)}));
+            step.emplace_back("subi", std::vector<ir::Operand>{down_counter, down_counter, 1});
+            step.emplace_back("bnez", std::vector<ir::Operand>{down_counter, body_label});
+            stats.add("loops counted down", 1);
+        } else {
+            step.emplace_back(std::string(ir::inverted_branch(test.opcode)), test.operands);
+            step.back().operands.back() = ir::Operand(body_label);
+        }
+
+        // the jumps into the body and back to the step now go to the next block, the peephole
+        // removes them
+        auto first = program.blocks.begin() + step_block;
+        std::rotate(first, first + 1, program.blocks.begin() + last_body + 1);
+        int after = last_body + 1;
+        if (after >= int(program.blocks.size()) || program.blocks[after].label != test.target())
+            program.blocks.insert(program.blocks.begin() + after, {"", {ir::Instr("b", {test.target()})}});
+        stats.add("loops rotated", 1);
+        return true;
+    }
+    return false;
+}
+
+/// @brief Branches and jumps to a block holding only a jump go to its target directly
+void thread_jumps(ir::Program &program, PassStats &stats) {
+    for (auto &bb: program.blocks) {
+        if (bb.instrs.empty() || !bb.instrs.back().is_terminator())
+            continue;
+        auto &terminator = bb.instrs.back();
+        std::string target = terminator.target();
+        // bounded by the block count, a cycle of jumps is left alone
+        for (std::size_t hops = 0; hops < program.blocks.size(); hops++) {
+            int block = program.find_block(target);
+            if (block < 0 || program.blocks[block].instrs.size() != 1 || !program.blocks[block].instrs[0].is_jump())
+                break;
+            target = program.blocks[block].instrs[0].target();
+        }
+        if (target != terminator.target()) {
+            terminator.operands.back() = ir::Operand(target);
+            stats.add("jumps threaded", 1);
+        }
+    }
+}
+
+/// @return label of the block control falls through to from given block, null if it has none
+const std::string *fall_through_label(const ir::Program &program, int block) {
+    for (std::size_t b = block + 1; b < program.blocks.size(); b++) {
+        if (!program.blocks[b].label.empty())
+            return &program.blocks[b].label;
+        if (!program.blocks[b].instrs.empty())
+            return nullptr;
+    }
+    return nullptr;
+}
+
+/// @brief bxx ..., L1; b L2; L1: becomes bnxx ..., L2; L1:
+void invert_branches_over_jumps(ir::Program &program, PassStats &stats) {
+    for (int b = 0; b + 1 < int(program.blocks.size()); b++) {
+        auto &instrs = program.blocks[b].instrs;
+        auto &jump_block = program.blocks[b + 1];
+        if (instrs.empty() || !instrs.back().is_branch() || !jump_block.label.empty()
+            || jump_block.instrs.size() != 1 || !jump_block.instrs[0].is_jump())
+            continue;
+        auto &branch = instrs.back();
+        auto inverted = ir::inverted_branch(branch.opcode);
+        auto label = fall_through_label(program, b + 1);
+        if (inverted.empty() || label == nullptr || *label != branch.target())
+            continue;
+        branch.opcode = std::string(inverted);
+        branch.operands.back() = jump_block.instrs[0].operands.back();
+        jump_block.instrs.clear();
+        stats.add("branches inverted", 1);
+    }
+}
+
+}
+
+void layout_blocks(ir::Program &program, PassStats &stats) {
+    // a rotated loop has its step block after the body and does not match again
+    while (rotate_one(program, stats)) {
+    }
+    thread_jumps(program, stats);
+    invert_branches_over_jumps(program, stats);
+}
+
+}
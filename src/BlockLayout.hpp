@@ -0,0 +1,13 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Rotates for loops so the counter test sits at the bottom and branches back to the
+/// body, leaving one taken branch per iteration and the exit on the fall-through. Loops with a
+/// literal trip count test a register counting down to zero instead of comparing the counter.
+/// Jumps to jumps are threaded and conditional branches over a jump are inverted.
+void layout_blocks(ir::Program &program, PassStats &stats);
+
+}
@@ -0,0 +1,191 @@
+#include "BoundsCheck.hpp"
+#include "LoopInfo.hpp"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+
+namespace passes {
+
+namespace {
+
+/// @brief Inclusive interval of the values a register or a variable may hold
+struct Range {
+    int64_t lo;
+    int64_t hi;
+};
+
+using MaybeRange = std::optional<Range>;
+
+bool fits_i32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+/// @return range or nothing when the result of the instruction would not fit and wrap or trap
+MaybeRange checked(int64_t lo, int64_t hi) {
+    if (!fits_i32(lo) || !fits_i32(hi))
+        return std::nullopt;
+    return Range{lo, hi};
+}
+
+MaybeRange add(const MaybeRange &a, const MaybeRange &b) {
+    if (!a || !b)
+        return std::nullopt;
+    return checked(a->lo + b->lo, a->hi + b->hi);
+}
+
+MaybeRange sub(const MaybeRange &a, const MaybeRange &b) {
+    if (!a || !b)
+        return std::nullopt;
+    return checked(a->lo - b->hi, a->hi - b->lo);
+}
+
+MaybeRange mul(const MaybeRange &a, const MaybeRange &b) {
+    if (!a || !b)
+        return std::nullopt;
+    int64_t corners[] = {a->lo * b->lo, a->lo * b->hi, a->hi * b->lo, a->hi * b->hi};
+    return checked(*std::min_element(std::begin(corners), std::end(corners)),
+                   *std::max_element(std::begin(corners), std::end(corners)));
+}
+
+bool is_bounds_check(const ir::Instr &instr) {
+    return instr.opcode == "bgeu" && instr.target() == ir::BOUNDS_FAIL_LABEL && instr.operands[0].is_reg()
+           && instr.operands[1].is_imm();
+}
+
+/// @brief Ranges known at one point of a block, walked forward over its instructions
+class BlockRanges {
+public:
+    BlockRanges(std::map<std::string, Range> counters, const std::vector<std::string> &address_taken)
+        : symbols(std::move(counters)), address_taken(address_taken) {}
+
+    MaybeRange operand(const ir::Operand &op) const {
+        if (op.is_imm()) {
+            int64_t value = std::stoll(op.text);
+            return Range{value, value};
+        }
+        auto found = op.is_reg() ? regs.find(op.text) : regs.end();
+        if (found == regs.end())
+            return std::nullopt;
+        return found->second;
+    }
+
+    void transfer(const ir::Instr &instr) {
+        auto &ops = instr.operands;
+        auto &opcode = instr.opcode;
+        MaybeRange result;
+        if (opcode == "li" || opcode == "move")
+            result = operand(ops[1]);
+        else if (opcode == "lw" && ops[1].is_symbol())
+            result = symbol(ops[1].text);
+        else if (ir::additive_sign(opcode) > 0)
+            result = add(operand(ops[1]), operand(ops[2]));
+        else if (ir::additive_sign(opcode) < 0)
+            result = sub(operand(ops[1]), operand(ops[2]));
+        else if (opcode == "mul")
+            result = mul(operand(ops[1]), operand(ops[2]));
+        else if (opcode == "sll" && ops[2].is_imm())
+            result = mul(operand(ops[1]), Range{int64_t(1) << (std::stoll(ops[2].text) & 31),
+                                                int64_t(1) << (std::stoll(ops[2].text) & 31)});
+
+        if (opcode == "sw" && ops[1].is_symbol() && !is_address_taken(ops[1].text)) {
+            if (auto stored = operand(ops[0]))
+                symbols[ops[1].text] = *stored;
+            else
+                symbols.erase(ops[1].text);
+        }
+
+        int def_operand = instr.info().def_operand;
+        for (auto &def: instr.defs()) {
+            if (result && def_operand >= 0 && ops[def_operand].text == def)
+                regs[def] = *result;
+            else
+                regs.erase(def);
+        }
+    }
+
+    /// @return true if the index of the check is always below the size
+    bool proves(const ir::Instr &check) const {
+        auto index = operand(check.operands[0]);
+        return index && index->lo >= 0 && index->hi < std::stoll(check.operands[1].text);
+    }
+
+    /// @brief Past a kept check the index is known to be in bounds
+    void assume_passed(const ir::Instr &check) {
+        Range bounds{0, std::stoll(check.operands[1].text) - 1};
+        if (auto index = operand(check.operands[0]))
+            bounds = {std::max(bounds.lo, index->lo), std::min(bounds.hi, index->hi)};
+        regs[check.operands[0].text] = bounds;
+    }
+
+private:
+    MaybeRange symbol(const std::string &name) const {
+        auto found = symbols.find(name);
+        if (found == symbols.end())
+            return std::nullopt;
+        return found->second;
+    }
+
+    bool is_address_taken(const std::string &name) const {
+        return std::find(address_taken.begin(), address_taken.end(), name) != address_taken.end();
+    }
+
+    std::map<std::string, Range> regs;
+    std::map<std::string, Range> symbols; // variables stored in the block or counters of enclosing loops
+    const std::vector<std::string> &address_taken;
+};
+
+/// @return ranges of the counters of the counted loops around every block
+std::vector<std::map<std::string, Range>> counter_ranges(const ir::Program &program,
+                                                         const std::vector<std::string> &address_taken) {
+    std::vector<std::map<std::string, Range>> ranges(program.blocks.size());
+    ir::LoopInfo loop_info(program);
+    for (auto &info: loop_info.loops()) {
+        auto loop = ir::match_counted_loop(program, info, address_taken);
+        if (!loop)
+            continue;
+        // the step block alone stores the counter, the body sees one value per iteration
+        int64_t last = loop->start + (loop->trip_count - 1) * loop->step;
+        Range range{std::min(loop->start, last), std::max(loop->start, last)};
+        for (int b = loop->first_body; b <= loop->last_body; b++)
+            ranges[b].emplace(loop->iv, range);
+    }
+    return ranges;
+}
+
+}
+
+void eliminate_bounds_checks(ir::Program &program, PassStats &stats) {
+    auto address_taken = ir::address_taken_symbols(program);
+    auto counters = counter_ranges(program, address_taken);
+
+    for (std::size_t b = 0; b < program.blocks.size(); b++) {
+        BlockRanges ranges(counters[b], address_taken);
+        auto &instrs = program.blocks[b].instrs;
+        for (std::size_t i = 0; i < instrs.size(); i++) {
+            if (!is_bounds_check(instrs[i])) {
+                ranges.transfer(instrs[i]);
+                continue;
+            }
+            if (!ranges.proves(instrs[i])) {
+                ranges.assume_passed(instrs[i]);
+                stats.add("checks kept", 1);
+                continue;
+            }
+            instrs.erase(instrs.begin() + long(i));
+            i--;
+            stats.add("checks removed", 1);
+
+            // the check ended the block, the unlabeled block after it continues this one
+            bool last = i + 1 == instrs.size();
+            if (last && b + 1 < program.blocks.size() && program.blocks[b + 1].label.empty()) {
+                auto &next = program.blocks[b + 1].instrs;
+                instrs.insert(instrs.end(), next.begin(), next.end());
+                program.blocks.erase(program.blocks.begin() + long(b) + 1);
+                counters.erase(counters.begin() + long(b) + 1);
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Removes array bounds checks (bgeu index, size, __bounds_fail) whose index is proven in
+/// range. Value ranges come from literals, arithmetic on them and the counters of counted loops,
+/// which take start + k * step for the iterations k of the loop. A kept check bounds its index
+/// for the rest of the block.
+void eliminate_bounds_checks(ir::Program &program, PassStats &stats);
+
+}
@@ -0,0 +1,319 @@
+#include "CompileCache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/// Bumped when the entry format or the meaning of keys changes
+constexpr int FORMAT_VERSION = 1;
+
+constexpr const char *ENTRY_SUFFIX = ".s";
+constexpr const char *TEMP_PREFIX = "tmp.";
+
+/// Temporary files of crashed writers older than this are deleted by eviction
+constexpr long STALE_TEMP_SECONDS = 3600;
+
+/// @brief 128 bit non-cryptographic hash, two independent multiplicative lanes over 8 byte words
+class Hasher {
+public:
+    void update(std::string_view data) {
+        length += data.size();
+        while (!data.empty()) {
+            if (pending_size == 0 && data.size() >= 8) {
+                uint64_t word;
+                std::memcpy(&word, data.data(), 8);
+                mix(word);
+                data.remove_prefix(8);
+                continue;
+            }
+            pending[pending_size++] = data[0];
+            data.remove_prefix(1);
+            if (pending_size == 8) {
+                uint64_t word;
+                std::memcpy(&word, pending, 8);
+                mix(word);
+                pending_size = 0;
+            }
+        }
+    }
+
+    std::string hex_digest() {
+        if (pending_size != 0) {
+            uint64_t word = 0;
+            std::memcpy(&word, pending, pending_size);
+            mix(word);
+        }
+        char hex[33];
+        std::snprintf(hex, sizeof hex, "%016llx%016llx", (unsigned long long) finalize(a ^ length),
+                      (unsigned long long) finalize(b + length));
+        return hex;
+    }
+
+private:
+    static uint64_t rotl(uint64_t value, int shift) {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+    /// @brief Murmur3 finalizer, every input bit affects every output bit
+    static uint64_t finalize(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    void mix(uint64_t word) {
+        a = rotl((a ^ word) * 0x9E3779B97F4A7C15ull, 29);
+        b = rotl(b + word * 0xC2B2AE3D27D4EB4Full, 31) * 0x165667B19E3779F9ull;
+    }
+
+    uint64_t a = 0x243F6A8885A308D3ull;
+    uint64_t b = 0x13198A2E03707344ull;
+    uint64_t length = 0;
+    char pending[8] = {};
+    std::size_t pending_size = 0;
+};
+
+void hash_options(Hasher &hasher, const std::string &build_id, const OptOptions &options, bool streaming) {
+    std::string header = build_id + "|O" + std::to_string(options.opt_level) + "|unroll" +
+                         std::to_string(options.unroll_factor) + "/" + std::to_string(options.unroll_budget) +
+                         (options.bounds_check ? "|bounds" : "") + (streaming ? "|stream|" : "|");
+    hasher.update(header);
+}
+
+/// @return identity of the running compiler binary, size and modification time of the executable
+std::string executable_id() {
+    struct stat info{};
+    if (stat("/proc/self/exe", &info) != 0)
+        return "unknown";
+    return std::to_string(info.st_size) + "." + std::to_string(info.st_mtim.tv_sec) + "." +
+           std::to_string(info.st_mtim.tv_nsec);
+}
+
+bool has_suffix(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+}
+
+std::string entry_header(std::size_t size) {
+    return "z5-cache " + std::to_string(FORMAT_VERSION) + " " + std::to_string(size) + "\n";
+}
+
+/// @brief Writes content to a uniquely named temporary file in directory and renames it to path,
+/// readers see either the previous file or the complete new one
+bool write_atomically(const std::string &directory, const std::string &path, std::string_view content) {
+    static std::atomic<unsigned> counter{0};
+    std::string temp_path = directory + "/" + TEMP_PREFIX + std::to_string(getpid()) + "." +
+                            std::to_string(counter++);
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return false;
+    const char *data = content.data();
+    std::size_t left = content.size();
+    bool ok = true;
+    while (left > 0) {
+        ssize_t written = write(fd, data, left);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) {
+            ok = false;
+            break;
+        }
+        data += written;
+        left -= std::size_t(written);
+    }
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+CompileCache::Stats read_stats(const std::string &path) {
+    CompileCache::Stats stats;
+    std::ifstream file(path);
+    std::string name;
+    uint64_t value;
+    while (file >> name >> value) {
+        if (name == "hits")
+            stats.hits = value;
+        else if (name == "misses")
+            stats.misses = value;
+        else if (name == "stores")
+            stats.stores = value;
+        else if (name == "evictions")
+            stats.evictions = value;
+        else if (name == "entries")
+            stats.entries = value;
+        else if (name == "bytes")
+            stats.bytes = value;
+    }
+    return stats;
+}
+
+std::string format_stats(const CompileCache::Stats &stats) {
+    std::ostringstream text;
+    text << "hits " << stats.hits << "\n"
+         << "misses " << stats.misses << "\n"
+         << "stores " << stats.stores << "\n"
+         << "evictions " << stats.evictions << "\n"
+         << "entries " << stats.entries << "\n"
+         << "bytes " << stats.bytes << "\n";
+    return text.str();
+}
+
+}
+
+CompileCache::CompileCache(std::string directory, uint64_t max_bytes)
+    : directory(std::move(directory)), max_bytes(max_bytes),
+      build_id("z5-" + std::to_string(FORMAT_VERSION) + "-" + executable_id()) {
+    if (mkdir(this->directory.c_str(), 0755) != 0 && errno != EEXIST)
+        throw std::runtime_error("cannot create cache directory " + this->directory + ": " + std::strerror(errno));
+}
+
+std::string CompileCache::key(std::string_view source, const OptOptions &options, bool streaming) const {
+    Hasher hasher;
+    hash_options(hasher, build_id, options, streaming);
+    hasher.update(source);
+    return hasher.hex_digest();
+}
+
+std::optional<std::string> CompileCache::key(std::FILE *input, const OptOptions &options, bool streaming) const {
+    Hasher hasher;
+    hash_options(hasher, build_id, options, streaming);
+    char chunk[1 << 16];
+    std::size_t count;
+    while ((count = std::fread(chunk, 1, sizeof chunk, input)) > 0)
+        hasher.update({chunk, count});
+    if (std::ferror(input) || std::fseek(input, 0, SEEK_SET) != 0)
+        return std::nullopt;
+    return hasher.hex_digest();
+}
+
+std::string CompileCache::entry_path(const std::string &key) const {
+    return directory + "/" + key + ENTRY_SUFFIX;
+}
+
+std::optional<std::string> CompileCache::lookup(const std::string &key) {
+    std::string path = entry_path(key);
+    std::ifstream file(path, std::ios::binary);
+    std::string header;
+    if (file.is_open() && std::getline(file, header)) {
+        std::string assembly(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>{});
+        if (header + "\n" == entry_header(assembly.size())) {
+            // the modification time orders the entries for eviction
+            utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+            hits++;
+            return assembly;
+        }
+    }
+    misses++;
+    return std::nullopt;
+}
+
+void CompileCache::store(const std::string &key, std::string_view assembly) {
+    std::string content = entry_header(assembly.size());
+    content += assembly;
+    if (write_atomically(directory, entry_path(key), content)) {
+        stores++;
+        stored_bytes += content.size();
+    }
+}
+
+CompileCache::Stats CompileCache::commit() {
+    std::string lock_path = directory + "/lock";
+    int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lock_fd >= 0)
+        flock(lock_fd, LOCK_EX);
+
+    std::string stats_path = directory + "/stats";
+    Stats stats = read_stats(stats_path);
+    stats.hits += hits.exchange(0);
+    stats.misses += misses.exchange(0);
+    uint64_t new_entries = stores.exchange(0);
+    stats.stores += new_entries;
+    stats.entries += new_entries;
+    stats.bytes += stored_bytes.exchange(0);
+    // entries and bytes only grow between evictions, which recount them
+    if (stats.bytes > max_bytes)
+        evict(stats);
+    write_atomically(directory, stats_path, format_stats(stats));
+
+    if (lock_fd >= 0)
+        close(lock_fd);
+    return stats;
+}
+
+void CompileCache::evict(Stats &stats) const {
+    struct Entry {
+        timespec used;
+        uint64_t size;
+        std::string path;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    DIR *dir = opendir(directory.c_str());
+    if (dir == nullptr)
+        return;
+    time_t now = time(nullptr);
+    while (dirent *item = readdir(dir)) {
+        std::string_view name = item->d_name;
+        std::string path = directory + "/" + item->d_name;
+        struct stat info{};
+        if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+            continue;
+        if (name.rfind(TEMP_PREFIX, 0) == 0) {
+            if (now - info.st_mtim.tv_sec > STALE_TEMP_SECONDS)
+                unlink(path.c_str());
+            continue;
+        }
+        if (!has_suffix(name, ENTRY_SUFFIX))
+            continue;
+        entries.push_back({info.st_mtim, uint64_t(info.st_size), std::move(path)});
+        total += uint64_t(info.st_size);
+    }
+    closedir(dir);
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &lhs, const Entry &rhs) {
+        if (lhs.used.tv_sec != rhs.used.tv_sec)
+            return lhs.used.tv_sec < rhs.used.tv_sec;
+        return lhs.used.tv_nsec < rhs.used.tv_nsec;
+    });
+    std::size_t kept_from = 0;
+    uint64_t target = max_bytes / 10 * 9;
+    while (kept_from < entries.size() && total > target) {
+        if (unlink(entries[kept_from].path.c_str()) == 0)
+            stats.evictions++;
+        total -= entries[kept_from].size;
+        kept_from++;
+    }
+    stats.entries = entries.size() - kept_from;
+    stats.bytes = total;
+}
+
+void print_cache_stats(std::ostream &ostream, const CompileCache::Stats &stats, uint64_t size_limit) {
+    uint64_t lookups = stats.hits + stats.misses;
+    ostream << "cache hits: " << stats.hits << std::endl
+            << "cache misses: " << stats.misses << std::endl
+            << "cache hit rate: " << (lookups == 0 ? 0 : stats.hits * 100 / lookups) << "%" << std::endl
+            << "cache entries: " << stats.entries << std::endl
+            << "cache size: " << stats.bytes << " bytes (limit " << size_limit << ")" << std::endl
+            << "cache evictions: " << stats.evictions << std::endl;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "PassManager.hpp"
+
+/// @brief Directory of generated assembly keyed by a hash of the source, the compiler build and
+/// the options, shared by concurrently running compiler processes. Entries are written to a
+/// temporary file and renamed into place, a hit refreshes the entry modification time and the
+/// least recently used entries are evicted once the directory grows over its size limit.
+/// Hit and miss counts of all runs are kept in the directory.
+class CompileCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t stores = 0;
+        uint64_t evictions = 0;
+        uint64_t entries = 0;
+        uint64_t bytes = 0;
+    };
+
+    /// @throws std::runtime_error when the directory can not be created
+    CompileCache(std::string directory, uint64_t max_bytes);
+
+    /// @return key of the compilation of source with given options
+    std::string key(std::string_view source, const OptOptions &options, bool streaming) const;
+
+    /// @brief Same as above for a source read from input, which is left at its beginning
+    /// @return key or nothing when input can not be read or rewound
+    std::optional<std::string> key(std::FILE *input, const OptOptions &options, bool streaming) const;
+
+    /// @return stored assembly, nothing on a miss
+    std::optional<std::string> lookup(const std::string &key);
+
+    /// @brief Stores assembly under key. Failures are ignored, without the entry the next
+    /// compilation of the source just misses.
+    void store(const std::string &key, std::string_view assembly);
+
+    /// @brief Adds the counts of this process to the statistics of the directory and evicts least
+    /// recently used entries when the directory is over its size limit
+    /// @return statistics of the directory after the update
+    Stats commit();
+
+    uint64_t size_limit() const { return max_bytes; }
+
+private:
+    std::string entry_path(const std::string &key) const;
+
+    /// @brief Deletes the oldest entries until the directory takes at most 90 % of the limit
+    void evict(Stats &stats) const;
+
+    std::string directory;
+    uint64_t max_bytes;
+    std::string build_id; // changes with every build of the compiler
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> stores{0};
+    std::atomic<uint64_t> stored_bytes{0};
+};
+
+void print_cache_stats(std::ostream &ostream, const CompileCache::Stats &stats, uint64_t size_limit);
@@ -1,29 +1,35 @@
 #include "Compiler.hpp"
+#include "MipsObject.hpp"
 
 #include <cassert>
 
-Compiler::Compiler(): stack(symbolTable), reg_mgr(this) {
+Compiler::Compiler(): literal_pool(symbolTable, interner), stack(symbolTable, interner, literal_pool), reg_mgr(this) {
 }
 
 void Compiler::gen_arithmetic(char op) {
-    std::string result_name = "result_" + std::to_string(tmp_counter);
-    std::string result_symbol = "__tmp_" + result_name;
+    Symbol result_symbol = interner.intern("__tmp_result_" + std::to_string(tmp_counter));
 
     auto [rhs, lhs] = stack.pop_two();
+    reg_mgr.begin_operation();
 
     // static calculation
-    if (lhs.is_literal_i32() && rhs.is_literal_i32()) {
-        stack.push(static_calculation(op, lhs, rhs));
-        return;
+    if (lhs.is_literal() && rhs.is_literal()) {
+        auto folded = static_calculation(op, lhs, rhs);
+        if (folded.has_value()) {
+            stack.push(folded.value());
+            return;
+        }
     }
+    promote_literal_operands(lhs, rhs);
 
     // Load left and right operands into registers
     std::optional<Reg> rhs_reg = std::nullopt;
     Reg lhs_reg = gen_load_to_register(lhs, true);
 
-    if (!rhs.is_literal_i32()) {
-        rhs_reg = gen_load_to_register(lhs);
-        gen_auto_reg_type_unify(rhs_reg.value(), lhs_reg);
+    // integer literal can be an immediate operand of integer instructions only
+    if (!rhs.is_literal_i32() || lhs_reg.get_type() == Reg::Type::F_REG) {
+        rhs_reg = gen_load_to_register(rhs);
+        gen_auto_reg_type_unify(lhs_reg, rhs_reg.value());
     }
 
     auto result_var_type = lhs_reg.get_type() == Reg::Type::F_REG ? VarType::F32 : VarType::I32;
@@ -33,23 +39,24 @@ void Compiler::gen_arithmetic(char op) {
     symbolTable[result_symbol] = {result_var_type, true};
 
     // write the operation to the text region
+    std::string opcode;
     switch (op) {
         case '-':
-            text_region << "sub";
+            opcode = "sub";
             break;
         case '+':
-            text_region << "add";
+            opcode = "add";
             break;
         case '*':
-            text_region << "mul";
+            opcode = "mul";
             break;
         case '/':
-            text_region << "div";
+            opcode = "div";
             break;
     }
 
-    std::string r = rhs_reg.has_value() ? rhs_reg.value().str() : rhs.value;
-    text_region << instr_postfix << " " << lhs_reg << ", " << lhs_reg << ", " << r << std::endl;
+    ir::Operand r = rhs_reg.has_value() ? ir::Operand(rhs_reg.value()) : ir::Operand(rhs.value);
+    program.emit(opcode + instr_postfix, {lhs_reg, lhs_reg, r});
 
     // push result to stack
     stack.push({result_symbol, ExprElemType::ID, result_var_type});
@@ -60,6 +67,7 @@ void Compiler::gen_arithmetic(char op) {
 
 void Compiler::gen_assignment() {
     auto [lhs, rhs] = stack.pop_two();
+    reg_mgr.begin_operation();
 
     if (lhs.type != ExprElemType::ID) {
         throw std::runtime_error("Left side of assignment must be an identifier");
@@ -68,31 +76,24 @@ void Compiler::gen_assignment() {
     auto found_sym = symbolTable.find(lhs.value);
 
     if (!found_sym.has_value()) {
-        throw std::runtime_error("undefined variable: " + lhs.value);
+        throw std::runtime_error("undefined variable: " + lhs.value.string());
     }
 
+    if (lhs.var_type == VarType::UNDEFINED)
+        lhs.var_type = found_sym.value()->type;
+
     // assignment to uninitialized variable
     bool assigned_statically = false;
     if (!found_sym.value()->initialized && !lhs.is_arr_elem) {
         found_sym.value()->initialized = true;
 
         if (loop_depth == 0 || lhs.var_type == VarType::U8_ARR) {
-            SymbolInfo *r_sym = nullptr;
-            if (rhs.type != ExprElemType::NUMBER)
-                r_sym = &symbolTable.at(rhs.value);
-
             if (rhs.type == ExprElemType::NUMBER) {
-                found_sym.value()->initial_value = rhs.value;
+                found_sym.value()->initial_value = convert_literal(rhs, lhs.var_type).value;
                 assigned_statically = true;
-            } else if (rhs.value.rfind("__str") == 0) {
-                found_sym.value()->initial_value = r_sym->initial_value;
-                symbolTable.erase(rhs.value);
-                assigned_statically = true;
-            } else if (rhs.value.rfind("__fl") == 0) {
-                if (lhs.var_type == VarType::I32)
-                    r_sym->initial_value = std::to_string(std::stoi(r_sym->initial_value));
-                found_sym.value()->initial_value = r_sym->initial_value;
-                symbolTable.erase(rhs.value);
+            } else if (rhs.value.starts_with("__str")) {
+                found_sym.value()->initial_value = literal_pool.string_text(rhs.value);
+                literal_pool.release_string(rhs.value);
                 assigned_statically = true;
             }
         }
@@ -100,6 +101,9 @@ void Compiler::gen_assignment() {
         throw std::runtime_error("reassignment of string is not allowed");
     }
 
+    if (rhs.is_literal() && VarType_is_num(lhs.var_type))
+        rhs = convert_literal(rhs, lhs.var_type);
+
     if (!assigned_statically) {
         auto rhs_reg = gen_load_to_register(rhs);
         // Conversion of right side to match left side variable type
@@ -114,7 +118,7 @@ void Compiler::gen_assignment() {
     reg_mgr.release_calc_results();
 }
 
-void Compiler::gen_declare(VarType type, const std::string &declare_id_name) {
+void Compiler::gen_declare(VarType type, Symbol declare_id_name) {
     if (VarType_is_num_array(type)) {
         declare_array(type, declare_id_name);
         return;
@@ -126,10 +130,10 @@ void Compiler::gen_declare(VarType type, const std::string &declare_id_name) {
         stack.push_id(declare_id_name, true);
     }
 
-    std::string symbol(stack.top().value);
+    Symbol symbol = stack.top().value;
 
     if (symbolTable.contains(symbol)) {
-        throw std::runtime_error("variable redeclaration: " + symbol);
+        throw std::runtime_error("variable redeclaration: " + symbol.string());
     }
 
     stack.top().var_type = type;
@@ -147,16 +151,18 @@ void Compiler::gen_if_begin() {
 
     static_assert(static_cast<int>(CondExprOp::EQ) == 0
                   && static_cast<int>(CondExprOp::GEQ) == 5);
-    std::array<std::array<std::string_view, 3>, 6> branch_instr = {{
-        { "bne ", "c.eq.s ", "bc1f " }, // CondExprOp::EQ
-        { "beq ", "c.eq.s ", "bc1t " }, // CondExprOp::NEQ
-        { "bge ", "c.lt.s ", "bc1f " }, // CondExprOp::LT
-        { "bgt ", "c.le.s ", "bc1f " }, // CondExprOp::LEQ
-        { "ble ", "c.le.s ", "bc1t " }, // CondExprOp::GT
-        { "blt ", "c.lt.s ", "bc1f " }  // CondExprOp::GEQ
+    std::array<std::array<const char *, 3>, 6> branch_instr = {{
+        { "bne", "c.eq.s", "bc1f" }, // CondExprOp::EQ
+        { "beq", "c.eq.s", "bc1t" }, // CondExprOp::NEQ
+        { "bge", "c.lt.s", "bc1f" }, // CondExprOp::LT
+        { "bgt", "c.le.s", "bc1f" }, // CondExprOp::LEQ
+        { "ble", "c.le.s", "bc1t" }, // CondExprOp::GT
+        { "blt", "c.lt.s", "bc1f" }  // CondExprOp::GEQ
     }};
 
     auto [rhs, lhs] = stack.pop_two();
+    reg_mgr.begin_operation();
+    promote_literal_operands(lhs, rhs);
 
     Reg lhs_reg = gen_load_to_register(lhs);
     Reg rhs_reg = gen_load_to_register(rhs);
@@ -165,17 +171,17 @@ void Compiler::gen_if_begin() {
 
     auto& bi = branch_instr[int(cond_expr_op)];
     if (lhs_reg.get_type() == Reg::Type::F_REG) {
-        text_region << bi[1] << lhs_reg << ", " << rhs_reg << std::endl;
-        text_region << bi[2] << jump_label << std::endl;
+        program.emit(bi[1], {lhs_reg, rhs_reg});
+        program.emit(bi[2], {jump_label});
     } else {
-        text_region << bi[0] << lhs_reg << ", " << rhs_reg << ", " << jump_label << std::endl;
+        program.emit(bi[0], {lhs_reg, rhs_reg, jump_label});
     }
 }
 
 void Compiler::gen_if_end() {
     std::string label = label_stack.top();
     label_stack.pop();
-    text_region << label << ":" << std::endl;
+    gen_label(label);
 }
 
 void Compiler::gen_else() {
@@ -183,8 +189,8 @@ void Compiler::gen_else() {
     label_stack.pop();
     std::string end_label = reserve_label();
 
-    text_region << "b " << end_label << std::endl;
-    text_region << else_label << ":" << std::endl;
+    program.emit("b", {end_label});
+    gen_label(else_label);
 }
 
 void Compiler::gen_for_begin() {
@@ -193,7 +199,8 @@ void Compiler::gen_for_begin() {
     label_stack.pop();
     std::string loop_start_label = reserve_label();
 
-    reg_mgr.gen_dump_calc_results_to_memory(text_region);
+    reg_mgr.gen_dump_calc_results_to_memory();
+    reg_mgr.begin_operation();
 
     // Get index variable and right-hand side value from the stack
     auto [range_stop, idx] = stack.pop_two();
@@ -201,22 +208,19 @@ void Compiler::gen_for_begin() {
     Reg range_start_reg = gen_load_to_register(range_start);
     gen_store_to_variable(idx, std::move(range_start_reg));
 
-    Reg idx_reg = std::move(range_start_reg);
-
     // write start of the loop label
-    text_region << "b " << loop_body_label << std::endl;
-    text_region << loop_start_label << ":" << std::endl;
-
-    std::string idx_reg_str = idx_reg.str();
-    idx_reg = gen_load_to_register(idx, idx_reg_str.c_str());
+    program.emit("b", {loop_body_label});
+    gen_label(loop_start_label);
 
     loop_depth++;
 
+    Reg idx_reg = gen_load_to_register(idx);
+
     // increment
     if (for_increment > 0) {
-        text_region << "addi " << idx_reg << ", " << idx_reg << ", " << for_increment << std::endl;
+        program.emit("addi", {idx_reg, idx_reg, for_increment});
     } else {
-        text_region << "subi " << idx_reg << ", " << idx_reg << ", " << -for_increment << std::endl;
+        program.emit("subi", {idx_reg, idx_reg, -for_increment});
     }
     gen_store_to_variable(idx, std::move(idx_reg));
 
@@ -229,8 +233,8 @@ void Compiler::gen_for_begin() {
     else
         branch_instr = (for_inclusive ? "blt" : "ble");
 
-    text_region << branch_instr << " " << idx_reg << ", " << rhs_reg << ", " << loop_end_label << std::endl;
-    text_region << loop_body_label << ":" << std::endl;
+    program.emit(branch_instr, {idx_reg, rhs_reg, loop_end_label});
+    gen_label(loop_body_label);
 }
 
 void Compiler::gen_for_end() {
@@ -239,16 +243,16 @@ void Compiler::gen_for_end() {
     std::string loop_end_label = label_stack.top();
     label_stack.pop();
 
-    text_region << "b " << loop_start_label << std::endl;
-    text_region << loop_end_label << ":" << std::endl;
+    program.emit("b", {loop_start_label});
     loop_depth--;
+    gen_label(loop_end_label);
 }
 
 void Compiler::set_cond_expr_op(CondExprOp op) {
     cond_expr_op = op;
 }
 
-void Compiler::set_for_conditions(const std::string &idx_id, bool inclusive, int increment) {
+void Compiler::set_for_conditions(Symbol idx_id, bool inclusive, int increment) {
     gen_declare(VarType::I32, idx_id);
 
     auto range_right = stack.pop();
@@ -262,19 +266,24 @@ void Compiler::set_for_conditions(const std::string &idx_id, bool inclusive, int
 Reg Compiler::gen_load_to_register(const StackEntry &entry, const char *reg_name) {
     Reg reg{};
 
+    if (entry.is_literal_f32())
+        return gen_load_to_register(stack.materialize_float_literal(entry), reg_name);
+
     if (entry.type == ExprElemType::ID) {
         auto symbol = symbolTable.find(entry.value);
         assert(symbol.has_value());
         if (symbol.value()->occupied_reg) {
+            reg_mgr.note_use(symbol.value()->occupied_reg);
             if (reg_name != nullptr && symbol.value()->occupied_reg.str() != reg_name) {
-                auto instruction = entry.var_type == VarType::F32 ? "mov.s " : "move ";
-                text_region << instruction
-                        << reg_name << ", " << symbol.value()->occupied_reg << std::endl;
+                auto instruction = entry.var_type == VarType::F32 ? "mov.s" : "move";
+                program.emit(instruction, {reg_name, symbol.value()->occupied_reg});
             }
             return symbol.value()->occupied_reg;
         }
     }
 
+    Reg cached = find_cached_variable(entry);
+
     if (reg_name == nullptr) {
         if (entry.var_type == VarType::I32) {
             reg = reg_mgr.get_free_register(Reg::Type::T_REG);
@@ -288,25 +297,35 @@ Reg Compiler::gen_load_to_register(const StackEntry &entry, const char *reg_name
 
     assert(!(entry.var_type != VarType::F32 && reg.get_type() == Reg::Type::F_REG));
 
-    text_region << "l" << entry.get_instr_postfix() << " "
-            << reg.str() << ", " << entry.value << std::endl;
+    if (cached) {
+        program.emit(entry.var_type == VarType::F32 ? "mov.s" : "move", {reg, cached});
+        return reg;
+    }
+
+    program.emit("l" + entry.get_instr_postfix(), {reg, entry.value});
 
-    return std::move(reg);
+    return reg;
 }
 
 Reg Compiler::gen_load_to_register(const StackEntry &entry, bool calc_result) {
     Reg reg{};
 
+    if (entry.is_literal_f32())
+        return gen_load_to_register(stack.materialize_float_literal(entry), calc_result);
+
     if (entry.type == ExprElemType::ID) {
         auto symbol = symbolTable.find(entry.value);
         assert(symbol.has_value());
         if (symbol.value()->occupied_reg) {
+            reg_mgr.note_use(symbol.value()->occupied_reg);
             return symbol.value()->occupied_reg;
         }
     }
 
     if (!calc_result)
-        return std::move(gen_load_to_register(entry));
+        return gen_load_to_register(entry);
+
+    Reg cached = find_cached_variable(entry);
 
     if (entry.var_type == VarType::I32)
         reg = reg_mgr.get_free_register(Reg::Type::T_REG, StoringType::CALC_RESULT);
@@ -317,33 +336,37 @@ Reg Compiler::gen_load_to_register(const StackEntry &entry, bool calc_result) {
         throw std::runtime_error("Out of registers");
     }
 
-    text_region << "l" << entry.get_instr_postfix(true) << " "
-            << reg.str() << ", " << entry.value << std::endl;
+    if (cached) {
+        program.emit(entry.var_type == VarType::F32 ? "mov.s" : "move", {reg, cached});
+        return reg;
+    }
+
+    program.emit("l" + entry.get_instr_postfix(true), {reg, entry.value});
 
-    return std::move(reg);
+    return reg;
 }
 
-Reg Compiler::gen_load_addr_to_register(const std::string &id) {
+Reg Compiler::gen_load_addr_to_register(Symbol id) {
     Reg reg = reg_mgr.get_free_register(Reg::Type::T_REG, StoringType::CALC_RESULT);
     if (!reg) {
         throw std::runtime_error("Out of registers");
     }
-    text_region << "la " << reg << ", " << id << std::endl;
-    return std::move(reg);
+    program.emit("la", {reg, id});
+    return reg;
 }
 
 void Compiler::gen_load_to_register(int value, std::string_view reg) {
-    text_region << "li " << reg << ", " << value << std::endl;
+    program.emit("li", {std::string(reg), value});
 }
 
 void Compiler::gen_cvt_i32_to_f32(const Reg &i_reg, const Reg &f_reg) {
-    text_region << "mtc1 " << i_reg << ", " << f_reg << std::endl;
-    text_region << "cvt.s.w " << f_reg << ", " << f_reg << std::endl;
+    program.emit("mtc1", {i_reg, f_reg});
+    program.emit("cvt.s.w", {f_reg, f_reg});
 }
 
 void Compiler::gen_cvt_f32_to_i32(const Reg &f_reg, const Reg &i_reg) {
-    text_region << "cvt.w.s " << f_reg << ", " << f_reg << std::endl;
-    text_region << "mfc1 " << i_reg << ", " << f_reg << std::endl;
+    program.emit("cvt.w.s", {f_reg, f_reg});
+    program.emit("mfc1", {i_reg, f_reg});
 }
 
 Reg Compiler::gen_cvt_i32_to_f32(const Reg &i_reg) {
@@ -379,7 +402,7 @@ void Compiler::gen_store_to_variable(const StackEntry &var, Reg &&reg) {
         }
     }
 
-    std::string var_s = var.value;
+    std::string var_s = var.value.string();
 
     if (var.is_arr_elem) {
         auto& sym = symbolTable.at(var.value);
@@ -391,12 +414,26 @@ void Compiler::gen_store_to_variable(const StackEntry &var, Reg &&reg) {
         }
         var_s += ")";
     }
-    if (var.value.rfind("__tmp") == 0) {
+    if (var.value.starts_with("__tmp")) {
         symbolTable.at(var.value).tmp_in_data_region = true;
     }
 
-    text_region << "s" << var.get_instr_postfix()
-            << " " << reg << ", " << var_s << std::endl;
+    program.emit("s" + var.get_instr_postfix(), {reg, var_s});
+
+    // keep the stored value in the register for the following statements
+    if (!var.is_arr_elem && !var.value.starts_with("__") && VarType_is_num(var.var_type))
+        reg_mgr.bind_variable(reg, var.value);
+}
+
+Reg Compiler::find_cached_variable(const StackEntry &entry) {
+    if (entry.type != ExprElemType::ID || entry.is_arr_elem || !VarType_is_num(entry.var_type))
+        return {};
+    return reg_mgr.find_variable(entry.value);
+}
+
+void Compiler::gen_label(const std::string &label) {
+    program.emit_label(label);
+    reg_mgr.invalidate_variables();
 }
 
 std::string Compiler::reserve_label() {
@@ -406,26 +443,73 @@ std::string Compiler::reserve_label() {
     return label_name;
 }
 
-int32_t Compiler::static_calculation(char op, const StackEntry &lhs, const StackEntry &rhs) {
-    int32_t l = std::stoi(lhs.value);
-    int32_t r = std::stoi(rhs.value);
+std::optional<StackEntry> Compiler::static_calculation(char op, const StackEntry &lhs, const StackEntry &rhs) {
+    assert(lhs.is_literal() && rhs.is_literal());
+
+    if (lhs.is_literal_i32() && rhs.is_literal_i32()) {
+        int64_t l = std::stoi(lhs.value.string());
+        int64_t r = std::stoi(rhs.value.string());
+        int64_t result;
+        switch (op) {
+            case '-': result = l - r; break;
+            case '+': result = l + r; break;
+            case '*': result = int32_t(uint32_t(l * r)); break; // mul does not trap, keeps low word
+            case '/':
+                if (r == 0 || (l == INT32_MIN && r == -1))
+                    return std::nullopt; // leave the undefined result to the runtime
+                result = l / r;
+                break;
+            default: assert(false);
+                return std::nullopt;
+        }
+        // add and sub trap on overflow at runtime
+        if (result < INT32_MIN || result > INT32_MAX)
+            return std::nullopt;
+        return StackEntry{interner.intern(std::to_string(result)), ExprElemType::NUMBER, VarType::I32};
+    }
+
+    // i32 operand is promoted the same way as cvt.s.w does, every step is rounded to f32
+    float l = lhs.literal_as_f32();
+    float r = rhs.literal_as_f32();
+    float result;
     switch (op) {
-        case '-': return l - r;
-        case '+': return l + r;
-        case '/': return l / r;
-        case '*': return l * r;
+        case '-': result = l - r; break;
+        case '+': result = l + r; break;
+        case '*': result = l * r; break;
+        case '/': result = l / r; break;
         default: assert(false);
-            return 0;
+            return std::nullopt;
     }
+    // data region can not express inf and nan literals
+    if (!std::isfinite(result))
+        return std::nullopt;
+    return StackEntry{interner.intern(format_f32(result)), ExprElemType::NUMBER, VarType::F32};
+}
+
+void Compiler::promote_literal_operands(StackEntry &lhs, StackEntry &rhs) {
+    if (lhs.is_literal_i32() && rhs.var_type == VarType::F32)
+        lhs = convert_literal(lhs, VarType::F32);
+    else if (rhs.is_literal_i32() && lhs.var_type == VarType::F32)
+        rhs = convert_literal(rhs, VarType::F32);
+}
+
+StackEntry Compiler::convert_literal(const StackEntry &literal, VarType type) {
+    assert(literal.is_literal());
+    if (type == VarType::I32 && literal.is_literal_f32())
+        return {interner.intern(std::to_string(f32_to_i32(literal.literal_as_f32()))), ExprElemType::NUMBER, VarType::I32};
+    if (type == VarType::F32 && literal.is_literal_i32())
+        return {interner.intern(format_f32(literal.literal_as_f32())), ExprElemType::NUMBER, VarType::F32};
+    return literal;
 }
 
 void Compiler::gen_print(VarType print_type) {
     auto stack_elem = stack.pop();
+    reg_mgr.begin_operation();
 
     // Check type
     if (!((stack_elem.var_type == VarType::I32 && print_type == VarType::I32)
-          || stack_elem.var_type == VarType::F32 && print_type == VarType::F32
-          || stack_elem.var_type == VarType::U8_ARR && print_type == VarType::U8_ARR)) {
+          || (stack_elem.var_type == VarType::F32 && print_type == VarType::F32)
+          || (stack_elem.var_type == VarType::U8_ARR && print_type == VarType::U8_ARR))) {
         throw std::runtime_error("Invalid print argument type");
     }
 
@@ -445,14 +529,14 @@ void Compiler::gen_print(VarType print_type) {
         default:
             throw std::runtime_error("gen_code_print unsupported type");
     }
-    text_region << "syscall" << std::endl;
+    program.emit("syscall", {});
 }
 
 void Compiler::add_idx_to_arr_idx_stack() {
     arr_idx_stack.push(stack.pop());
 }
 
-void Compiler::declare_array(VarType type, const std::string &id) {
+void Compiler::declare_array(VarType type, Symbol id) {
     assert(!static_array_dims.empty());
 
     if (symbolTable.contains(id))
@@ -474,7 +558,7 @@ void Compiler::declare_array(VarType type, const std::string &id) {
     SymbolInfo symbol{
         .type = type,
         .temporary = false,
-        .initial_value = "0:" + std::to_string(cur_size),
+        .initial_value = interner.intern("0:" + std::to_string(cur_size)),
         .array_dims = dims,
         .array_sizes = sizes,
         .initialized = true
@@ -484,38 +568,158 @@ void Compiler::declare_array(VarType type, const std::string &id) {
 
 void Compiler::write_data_region(std::ostream &ostream) const {
     ostream << ".data:" << std::endl;
+    std::vector<std::pair<Symbol, Symbol>> string_literals;
     for (auto &symbol: symbolTable) {
         assert(!(symbol.second.temporary && symbol.first[0] != '_'));
-        if (symbol.second.temporary && !symbol.second.tmp_in_data_region)
+        if ((symbol.second.temporary && !symbol.second.tmp_in_data_region) || symbol.second.unused)
             continue;
+        if (symbol.first.starts_with("__str"))
+            string_literals.emplace_back(symbol.first, symbol.second.initial_value);
+        else
+            write_data_entry(ostream, symbol.first, symbol.second);
+    }
+    write_string_literals(ostream, string_literals);
+    ostream << std::endl;
+}
 
-        ostream << symbol.first << ":    ";
-        auto value = symbol.second.initial_value;
+void Compiler::write_data_entry(std::ostream &ostream, Symbol symbol, const SymbolInfo &info) {
+    ostream << symbol << ":    ";
+    auto value = info.initial_value;
 
-        switch (symbol.second.type) {
-            case VarType::I32:
-            case VarType::I32_ARR:
-                ostream << ".word    ";
-                break;
-            case VarType::F32:
-            case VarType::F32_ARR:
-                ostream << ".float    ";
-                break;
-            case VarType::U8_ARR:
-                ostream << ".asciiz    ";
-                break;
-            default:
-                throw std::runtime_error("unsupported type");
+    switch (info.type) {
+        case VarType::I32:
+        case VarType::I32_ARR:
+            ostream << ".word    ";
+            break;
+        case VarType::F32:
+        case VarType::F32_ARR:
+            ostream << ".float    ";
+            break;
+        case VarType::U8_ARR:
+            // literals are interned without their quotes
+            ostream << ".asciiz    \"" << value << "\"" << std::endl;
+            return;
+        default:
+            throw std::runtime_error("unsupported type");
+    }
+
+    ostream << (value.empty() ? std::string_view("0") : value.str()) << std::endl;
+}
+
+void Compiler::begin_streaming(std::ostream &out, const OptOptions &options, std::ostream &dump_stream) {
+    streaming.reset(new Streaming{out, dump_stream, PassManager::create_default(options, false)});
+}
+
+void Compiler::end_streaming() {
+    if (!bounds_fail_needed)
+        return;
+    bounds_fail_needed = false;
+    gen_bounds_fail_handler();
+    flush_statements();
+}
+
+void Compiler::end_statement() {
+    // statements nested in if and for bodies are flushed with the enclosing one
+    if (streaming && label_stack.empty() && loop_depth == 0)
+        flush_statements();
+}
+
+void Compiler::flush_statements() {
+    // runs inside the semantic action of the statement, keep it out of the codegen time
+    parse_trace.enter(trace::ParseTrace::Phase::NONE);
+    trace::Span span("flush", this);
+    streaming->pass_manager.run(program, streaming->dump_stream);
+    bounds_fail_needed |= has_bounds_checks();
+    update_temporary_storage(streaming->data_mark);
+
+    auto &out = streaming->out;
+    bool data_header = false;
+    std::vector<Symbol> temporaries;
+    std::vector<std::pair<Symbol, Symbol>> string_literals;
+    for (auto it = symbolTable.since(streaming->data_mark); it != symbolTable.end(); ++it) {
+        auto &[symbol, info] = *it;
+        if (info.temporary)
+            temporaries.push_back(symbol);
+        if (info.temporary) {
+            if (!info.tmp_in_data_region || streaming->emitted_temporaries.contains(symbol))
+                continue;
+            streaming->emitted_temporaries[symbol] = true;
+        }
+        if (!data_header) {
+            out << ".data:" << std::endl;
+            data_header = true;
         }
+        if (symbol.starts_with("__str"))
+            string_literals.emplace_back(symbol, info.initial_value);
+        else
+            write_data_entry(out, symbol, info);
+        // the value is in the output, later assignments have to be stored by code
+        info.initialized = true;
+    }
+
+    write_string_literals(out, string_literals);
+
+    // temporaries are not referred to by later statements, pooled literals stay for their next use.
+    // Registers may still hold results owned by them, e.g. an array element read by a print.
+    reg_mgr.release_calc_results();
+    for (auto symbol: temporaries)
+        symbolTable.erase(symbol);
+    symbolTable.compact();
+    streaming->data_mark = symbolTable.insertion_mark();
+
+    if (!program.empty()) {
+        out << ".text:" << std::endl;
+        program.write(out);
+    }
+    flushed_instructions += program.emitted_count();
+    program = ir::Program();
+    reg_mgr.invalidate_variables();
+    tmp_counter = 0;
+    parse_trace.enter(trace::ParseTrace::Phase::CODEGEN);
+}
 
-        ostream << (value.empty() ? "0" : value) << std::endl;
+void Compiler::optimize(const OptOptions &options, std::ostream &dump_stream) {
+    PassManager pass_manager = PassManager::create_default(options);
+    pass_manager.run(program, dump_stream);
+    if (has_bounds_checks())
+        gen_bounds_fail_handler();
+    update_temporary_storage(0, options.opt_level >= 1);
+}
+
+void Compiler::update_temporary_storage(std::size_t mark, bool drop_unused) {
+    HashMap<std::string, bool> referenced;
+    for (auto &bb: program.blocks) {
+        for (auto &instr: bb.instrs) {
+            for (auto &operand: instr.operands) {
+                if (!operand.is_symbol() || !(drop_unused || operand.text.rfind("__tmp", 0) == 0))
+                    continue;
+                referenced[operand.text.substr(0, operand.text.find('+'))] = true;
+            }
+        }
+    }
+    for (auto it = symbolTable.since(mark); it != symbolTable.end(); ++it) {
+        if (it->second.temporary)
+            it->second.tmp_in_data_region = referenced.contains(it->first.str());
+        else if (drop_unused)
+            it->second.unused = !referenced.contains(it->first.str());
     }
-    ostream << std::endl;
+}
+
+trace::Counters Compiler::trace_counters() const {
+    return {parse_trace.tokens, parse_trace.reductions, flushed_instructions + program.emitted_count(),
+            symbolTable.lookup_count()};
 }
 
 void Compiler::write_text_region(std::ostream &ostream) const {
     ostream << ".text:" << std::endl;
-    ostream << text_region.str() << std::endl;
+    program.write(ostream);
+    ostream << std::endl;
+}
+
+void Compiler::write_object(std::ostream &ostream) const {
+    std::stringstream data;
+    write_data_region(data);
+    mips::write_object(data, program, ostream);
 }
 
 
@@ -532,6 +736,7 @@ void Compiler::gen_auto_reg_type_unify(Reg &reg1, Reg &reg2) {
 void Compiler::gen_calc_arr_addr(bool extract) {
     auto inds = stack_dump_to_vector(arr_idx_stack);
     auto id = stack.pop();
+    reg_mgr.begin_operation();
 
     for (const auto& ind : inds) {
         if (ind.var_type != VarType::I32)
@@ -548,7 +753,7 @@ void Compiler::gen_calc_arr_addr(bool extract) {
     // load array address
     Reg addr_reg = gen_load_addr_to_register(id.value);
 
-    std::string tmp_res_sym_name = "__tmp_addr" + std::to_string(tmp_counter++);
+    Symbol tmp_res_sym_name = interner.intern("__tmp_addr" + std::to_string(tmp_counter++));
     symbolTable.insert(tmp_res_sym_name, SymbolInfo{
                            .type = VarType::I32,
                            .temporary = true,
@@ -559,20 +764,28 @@ void Compiler::gen_calc_arr_addr(bool extract) {
     if (!inds[0].is_literal_i32()) {
         Reg idx_reg = gen_load_to_register(inds[0]);
         idx_operand = idx_reg.str();
-        text_region << "mul " << idx_reg << ", " << idx_reg << ", 4" << std::endl;
+        if (bounds_checks)
+            gen_bounds_check(idx_reg, sym.array_dims[0]);
+        program.emit("mul", {idx_reg, idx_reg, 4});
     } else {
-        idx_operand = std::to_string(std::stoi(inds[0].value) * 4);
+        if (bounds_checks)
+            check_literal_index(inds[0], sym.array_dims[0]);
+        idx_operand = std::to_string(std::stoi(inds[0].value.string()) * 4);
     }
 
-    text_region << "add " << addr_reg << ", " << addr_reg << ", " << idx_operand << std::endl;
+    program.emit("add", {addr_reg, addr_reg, idx_operand});
 
     // rest of dimensions
-    for (int i = 1; i < inds.size(); i++) {
+    for (std::size_t i = 1; i < inds.size(); i++) {
         Reg idx_reg = gen_load_to_register(inds[i]);
 
-        text_region << "mul " << idx_reg << ", " << idx_reg << ", 4" << std::endl;
-        text_region << "mul " << idx_reg << ", " << idx_reg << ", " << std::to_string(sym.array_sizes[i]) << std::endl;
-        text_region << "add " << addr_reg << ", " << addr_reg << ", " << idx_reg << std::endl;
+        if (bounds_checks && inds[i].is_literal_i32())
+            check_literal_index(inds[i], sym.array_dims[i]);
+        else if (bounds_checks)
+            gen_bounds_check(idx_reg, sym.array_dims[i]);
+        program.emit("mul", {idx_reg, idx_reg, 4});
+        program.emit("mul", {idx_reg, idx_reg, sym.array_sizes[i]});
+        program.emit("add", {addr_reg, addr_reg, idx_reg});
         idx_reg.release();
     }
 
@@ -583,7 +796,7 @@ void Compiler::gen_calc_arr_addr(bool extract) {
         if (type == VarType::F32) {
             dest = reg_mgr.get_free_register(Reg::Type::F_REG, StoringType::CALC_RESULT);
         }
-        text_region << "l" << (type == VarType::I32 ? "w" : ".s") << " " << dest << ", (" << addr_reg << ")" << std::endl;
+        program.emit(type == VarType::I32 ? "lw" : "l.s", {dest, ir::Operand::mem(addr_reg.str())});
         if (type == VarType::F32)
             addr_reg = std::move(dest);
     }
@@ -593,3 +806,37 @@ void Compiler::gen_calc_arr_addr(bool extract) {
     gen_store_to_variable(stack.top(), std::move(addr_reg));
     stack.top().is_arr_elem = !extract;
 }
+
+void Compiler::gen_bounds_check(const Reg &index, int32_t size) {
+    // one unsigned compare also catches negative indices
+    program.emit("bgeu", {index, size, std::string(ir::BOUNDS_FAIL_LABEL)});
+}
+
+void Compiler::check_literal_index(const StackEntry &index, int32_t size) const {
+    int32_t value = std::stoi(index.value.string());
+    if (value < 0 || value >= size) {
+        throw std::runtime_error("array index " + std::to_string(value) + " out of bounds of dimension of size " +
+                                 std::to_string(size));
+    }
+}
+
+bool Compiler::has_bounds_checks() const {
+    for (auto &bb: program.blocks) {
+        if (!bb.instrs.empty() && bb.instrs.back().is_branch() && bb.instrs.back().target() == ir::BOUNDS_FAIL_LABEL)
+            return true;
+    }
+    return false;
+}
+
+void Compiler::gen_bounds_fail_handler() {
+    Symbol message = literal_pool.string_symbol(interner.intern("array index out of bounds\\n"));
+    // the program ends here, it must not fall through into the handler
+    program.emit("li", {"$v0", 10});
+    program.emit("syscall", {});
+    gen_label(std::string(ir::BOUNDS_FAIL_LABEL));
+    program.emit("la", {"$a0", message});
+    program.emit("li", {"$v0", 4});
+    program.emit("syscall", {});
+    program.emit("li", {"$v0", 10});
+    program.emit("syscall", {});
+}
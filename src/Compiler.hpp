@@ -2,8 +2,13 @@
 #include "MainStack.hpp"
 #include "HashMap.hpp"
 #include "RegisterManager.hpp"
+#include "Ir.hpp"
+#include "PassManager.hpp"
+#include "Trace.hpp"
 #include "common.hpp"
 
+#include <memory>
+
 class Compiler {
 public:
     Compiler();
@@ -13,7 +18,7 @@ public:
     void gen_assignment();
 
     /// @param declare_id_name for declaration without initialization
-    void gen_declare(VarType type, const std::string &declare_id_name="");
+    void gen_declare(VarType type, Symbol declare_id_name = {});
 
     void gen_if_begin();
 
@@ -31,28 +36,55 @@ public:
 
     void set_cond_expr_op(CondExprOp op);
 
-    void set_for_conditions(const std::string &idx_id, bool inclusive, int increment = 1);
+    void set_for_conditions(Symbol idx_id, bool inclusive, int increment = 1);
+
+    /// @brief Switches to streaming emission: every completed top-level statement is optimized
+    /// and written to out as its own .data/.text pair, so memory does not grow with the program
+    void begin_streaming(std::ostream &out, const OptOptions &options, std::ostream &dump_stream);
+
+    /// @brief Called by the parser after every statement, flushes top-level ones in streaming mode
+    void end_statement();
+
+    /// @brief Writes what streaming mode still owes after the last statement, the bounds check
+    /// failure handler when a streamed statement kept a check
+    void end_streaming();
+
+    /// @brief Makes array accesses check every index against its dimension, literal indices at
+    /// compile time and the others at run time with a jump to a handler ending the program
+    void enable_bounds_checks() { bounds_checks = true; }
 
     void write_data_region(std::ostream &ostream) const;
 
     void write_text_region(std::ostream &ostream) const;
 
+    /// @brief Writes the program as a relocatable MIPS ELF object instead of the two regions
+    void write_object(std::ostream &ostream) const;
+
+    /// @brief Runs the optimization pipeline over the generated IR
+    void optimize(const OptOptions &options, std::ostream &dump_stream);
+
     void gen_calc_arr_addr(bool extract);
 
+    /// @return counts of the compilation so far, sampled by trace spans
+    trace::Counters trace_counters() const;
+
 public:
+    Interner interner; // owns every identifier, literal and generated name of the program
+    LiteralPool literal_pool;
     MainStack stack;
     RegisterManager reg_mgr;
-    HashMap<std::string, SymbolInfo> symbolTable;
+    HashMap<Symbol, SymbolInfo> symbolTable;
     std::stack<int32_t> static_array_dims;
+    trace::ParseTrace parse_trace; // tokens and reductions, counted by the parser
 
 private:
-    void declare_array(VarType type, const std::string &id);
+    void declare_array(VarType type, Symbol id);
 
     Reg gen_load_to_register(const StackEntry &entry, const char *reg_name = nullptr);
 
     [[nodiscard]] Reg gen_load_to_register(const StackEntry &entry, bool calc_result);
 
-    [[nodiscard]] Reg gen_load_addr_to_register(const std::string &id);
+    [[nodiscard]] Reg gen_load_addr_to_register(Symbol id);
 
     void gen_load_to_register(int value, std::string_view reg);
 
@@ -66,17 +98,51 @@ private:
 
     void gen_auto_reg_type_unify(Reg &reg1, Reg &reg2);
 
+    void gen_bounds_check(const Reg &index, int32_t size);
+
+    /// @throws std::runtime_error when the literal index is out of bounds
+    void check_literal_index(const StackEntry &index, int32_t size) const;
+
+    /// @return true if the program branches to the bounds check failure handler
+    bool has_bounds_checks() const;
+
+    /// @brief Ends the program and emits the handler failed bounds checks jump to
+    void gen_bounds_fail_handler();
+
     void gen_store_to_variable(const StackEntry &var, Reg &&reg);
 
+    /// @return register with the cached value of the variable or an invalid Reg
+    Reg find_cached_variable(const StackEntry &entry);
+
+    void gen_label(const std::string &label);
+
     std::string reserve_label();
 
-    static int32_t static_calculation(char op, const StackEntry &lhs, const StackEntry &rhs);
+    static void write_data_entry(std::ostream &ostream, Symbol symbol, const SymbolInfo &info);
+
+    /// @brief Keeps in the data region only the temporaries the optimized code still refers to,
+    /// looking at the symbols inserted after given symbol table mark
+    /// @param drop_unused leave out the variables and literals it does not refer to either,
+    /// only when the program holds every statement
+    void update_temporary_storage(std::size_t mark, bool drop_unused = false);
+
+    /// @brief Writes the code and the data symbols of the statements parsed since the last flush
+    void flush_statements();
+
+    /// @brief Folds arithmetic on i32 and f32 literals with the semantics of the emitted instructions
+    /// @return folded literal or nothing if the result has to be left to the runtime
+    std::optional<StackEntry> static_calculation(char op, const StackEntry &lhs, const StackEntry &rhs);
+
+    StackEntry convert_literal(const StackEntry &literal, VarType type);
+
+    /// @brief Converts i32 literal paired with f32 operand at compile time instead of with cvt.s.w
+    void promote_literal_operands(StackEntry &lhs, StackEntry &rhs);
 
 private:
     using StoringType = RegisterManager::StoringType;
 
     std::stringstream data_region;
-    std::stringstream text_region;
+    ir::Program program;
 
     std::stack<std::string> label_stack;
     std::stack<StackEntry> arr_idx_stack;
@@ -87,6 +153,20 @@ private:
     int for_increment = 1;
     int loop_depth = 0;
     int tmp_counter = 0;
+    bool bounds_checks = false;
+    bool bounds_fail_needed = false; // a streamed statement kept a bounds check
+    uint64_t flushed_instructions = 0; // emitted by the statements already streamed out
+
+    struct Streaming {
+        std::ostream &out;
+        std::ostream &dump_stream;
+        PassManager pass_manager;
+        std::size_t data_mark = 0; // symbol table insertion mark of the last flush
+        HashMap<Symbol, bool> emitted_temporaries{}; // temporaries are renumbered from 0 after every flush
+    };
+    std::unique_ptr<Streaming> streaming; // null when the whole program is buffered
+
+    friend class RegisterManager;
 };
 
 
@@ -0,0 +1,177 @@
+#include "DeadStores.hpp"
+#include "Liveness.hpp"
+
+#include <map>
+#include <set>
+
+namespace passes {
+
+namespace {
+
+std::string base_symbol(const std::string &symbol) {
+    return symbol.substr(0, symbol.find('+'));
+}
+
+using Symbols = std::set<std::string>;
+
+/// @brief What a register holds, followed through one block
+struct RegValue {
+    Symbols pointees; // symbols the register may point into, from la and address arithmetic
+    Symbols sources;  // symbols the value was computed from
+};
+
+/// @brief Data flow between symbols. A symbol is needed when its value may reach a syscall, a
+/// branch or a memory address, directly or through needed symbols it is stored to. The other
+/// symbols are dead, nothing observable reads them. A register live across blocks is a symbol
+/// of its own, named by the register, that the blocks it is live out of store to.
+class SymbolFlow {
+public:
+    /// @brief Walks the block, recording needed symbols and stores between symbols
+    void add_block(const ir::BasicBlock &bb, const ir::RegSet &live_in, const ir::RegSet &live_out) {
+        regs.clear();
+        entry_live = &live_in;
+        for (auto &instr: bb.instrs)
+            step(instr);
+        for (auto &[reg, value]: regs) {
+            int bit = ir::reg_bit(reg);
+            if (bit < 0) {
+                need(value);
+            } else if (live_out.test(bit)) {
+                need_all(value.pointees); // addresses are not followed across blocks
+                flow(value.sources, reg);
+            }
+        }
+    }
+
+    /// @brief Closes the needed set over the recorded stores
+    /// @param root true for symbols needed regardless of the program, e.g. read by later statements
+    template<class Root>
+    void solve(Root root) {
+        std::vector<std::string> worklist;
+        for (auto &[target, sources]: stored_from) {
+            if (root(target))
+                needed.insert(target);
+        }
+        worklist.assign(needed.begin(), needed.end());
+        while (!worklist.empty()) {
+            auto symbol = worklist.back();
+            worklist.pop_back();
+            auto found = stored_from.find(symbol);
+            if (found == stored_from.end())
+                continue;
+            for (auto &source: found->second) {
+                if (needed.insert(source).second)
+                    worklist.push_back(source);
+            }
+        }
+    }
+
+    bool is_needed(const std::string &symbol) const {
+        return needed.count(symbol) != 0;
+    }
+
+    /// @brief Moves past the instruction, recording what it needs and stores
+    void step(const ir::Instr &instr) {
+        auto &ops = instr.operands;
+        auto kind = instr.info().kind;
+        RegValue result;
+
+        if (instr.is_store()) {
+            RegValue stored = value(ops[0].text);
+            need_all(stored.pointees); // the address escapes into memory
+            if (ops[1].is_symbol()) {
+                flow(stored.sources, base_symbol(ops[1].text));
+            } else {
+                RegValue address = value(ops[1].text);
+                stored.sources.insert(address.sources.begin(), address.sources.end());
+                if (address.pointees.empty())
+                    need_all(stored.sources); // unknown target
+                for (auto &target: address.pointees)
+                    flow(stored.sources, target);
+            }
+        } else if (instr.opcode == "la") {
+            result.pointees.insert(base_symbol(ops[1].text));
+        } else if (instr.is_load() && ops[1].is_symbol()) {
+            result.sources.insert(base_symbol(ops[1].text));
+        } else if (kind == ir::OpInfo::Kind::ARITHMETIC || kind == ir::OpInfo::Kind::COMPARE || instr.is_load()) {
+            for (auto &use: instr.uses()) {
+                RegValue used = value(use);
+                if (instr.is_load())
+                    used.sources.insert(used.pointees.begin(), used.pointees.end()); // read through it
+                result.pointees.insert(used.pointees.begin(), used.pointees.end());
+                result.sources.insert(used.sources.begin(), used.sources.end());
+            }
+            if (instr.is_load())
+                result.pointees.clear();
+        } else {
+            // syscalls and branches observe everything they read
+            for (auto &use: instr.uses())
+                need(value(use));
+            for (auto &op: ops) {
+                if (op.is_symbol() && !instr.is_terminator())
+                    needed.insert(base_symbol(op.text));
+            }
+        }
+
+        for (auto &def: instr.defs())
+            regs[def] = result;
+    }
+
+private:
+    RegValue value(const std::string &reg) const {
+        auto found = regs.find(reg);
+        if (found != regs.end())
+            return found->second;
+        int bit = ir::reg_bit(reg);
+        if (entry_live != nullptr && bit >= 0 && entry_live->test(bit))
+            return RegValue{{}, {reg}}; // whatever the blocks it is live out of stored
+        return {};
+    }
+
+    void need(const RegValue &value) {
+        need_all(value.pointees);
+        need_all(value.sources);
+    }
+
+    void need_all(const Symbols &symbols) {
+        needed.insert(symbols.begin(), symbols.end());
+    }
+
+    void flow(const Symbols &sources, const std::string &target) {
+        auto &into = stored_from[target];
+        into.insert(sources.begin(), sources.end());
+    }
+
+    std::map<std::string, RegValue> regs; // written in the current block
+    const ir::RegSet *entry_live = nullptr; // registers live into the current block
+    std::map<std::string, Symbols> stored_from; // stored symbol -> symbols its values come from
+    Symbols needed;
+};
+
+}
+
+void eliminate_dead_stores(ir::Program &program, PassStats &stats, bool whole_program) {
+    ir::Liveness liveness(program);
+    SymbolFlow flow;
+    for (int b = 0; b < int(program.blocks.size()); b++)
+        flow.add_block(program.blocks[b], liveness.live_in(b), liveness.live_out(b));
+    // later statements never refer to the temporaries of a flushed one
+    flow.solve([whole_program](const std::string &symbol) {
+        return !whole_program && symbol.rfind("__tmp", 0) != 0;
+    });
+
+    for (auto &bb: program.blocks) {
+        auto &instrs = bb.instrs;
+        for (std::size_t i = 0; i < instrs.size(); i++) {
+            auto &instr = instrs[i];
+            // a store through a computed address faults on a bad one, even when nothing reads it
+            if (!instr.is_store() || instr.may_trap() || flow.is_needed(base_symbol(instr.operands[1].text)))
+                continue;
+            stats.add("variable stores", 1);
+            instrs.erase(instrs.begin() + long(i));
+            i--;
+        }
+    }
+}
+
+}
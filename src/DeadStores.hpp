@@ -0,0 +1,16 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Removes stores by name to data symbols the program never reads, by name or through an
+/// address, so the computations of the stored values die and peephole removes them as well,
+/// unless they may trap. Stores through an address stay, they fault when it is out of range.
+/// Addresses loaded with la are followed through the registers of their block, an address
+/// leaving that way (printed, stored, live at the block end) counts as a read of its symbol.
+/// @param whole_program the program contains every statement, otherwise later statements may
+/// read the variables and only stores to temporaries are removed
+void eliminate_dead_stores(ir::Program &program, PassStats &stats, bool whole_program);
+
+}
@@ -0,0 +1,493 @@
+#include "Driver.hpp"
+#include "CompileCache.hpp"
+#include "Compiler.hpp"
+#include "Jit.hpp"
+#include "MappedFile.hpp"
+#include "MemStats.hpp"
+#include "Parser.hpp"
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <sstream>
+
+namespace {
+
+bool read_file(const std::string &path, std::string &content) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool has_suffix(std::string_view text, std::string_view suffix) {
+    return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+}
+
+/// @return path of the output for given input with given extension, in out_dir when it is not empty
+std::string output_path_for(const std::string &input_path, const std::string &out_dir, std::string_view extension) {
+    std::string name = input_path;
+    if (!out_dir.empty()) {
+        auto slash = name.find_last_of('/');
+        if (slash != std::string::npos)
+            name = name.substr(slash + 1);
+        name = out_dir + "/" + name;
+    }
+    if (has_suffix(name, ".t"))
+        name.resize(name.size() - 2);
+    return name.append(extension);
+}
+
+void print_usage(std::ostream &ostream) {
+    ostream << "usage: compiler [options] [output.s] < input.t" << std::endl
+            << "       compiler [options] [-j N] [--out-dir DIR] input.t..." << std::endl
+            << "       compiler [options] --run|--emit-obj [-j N] [--out-dir DIR] [input.t...]" << std::endl
+            << "options: -O0 (default) -O1 -O2 --stream --bounds-check --dump-ir --opt-stats --mem-stats --trace=FILE" << std::endl
+            << "         --unroll=FACTOR --unroll-budget=INSTRUCTIONS" << std::endl
+            << "         --cache-dir=DIR --cache-size=MIB --cache-stats" << std::endl;
+}
+
+/// @brief compile_source answered from the cache when there is one
+std::string compile_cached(ScanBuffer source, const OptOptions &options, std::ostream &diagnostics,
+                           CompileCache *cache) {
+    std::string key;
+    if (cache) {
+        trace::Span span("cache_lookup");
+        key = cache->key(source.text(), options, false);
+        if (auto assembly = cache->lookup(key))
+            return std::move(*assembly);
+    }
+    std::ostringstream assembly;
+    compile_source(source, assembly, options, diagnostics);
+    if (cache)
+        cache->store(key, assembly.str());
+    return assembly.str();
+}
+
+/// @brief Records a Chrome trace for its lifetime when given a path, the file is written when
+/// the session ends, also after failed compilations
+class TraceSession {
+public:
+    explicit TraceSession(std::string path) : path(std::move(path)) {
+        if (this->path.empty())
+            return;
+        recorder = std::make_unique<trace::Recorder>();
+        trace::set_active(recorder.get());
+    }
+
+    ~TraceSession() {
+        if (!recorder)
+            return;
+        trace::set_active(nullptr);
+        std::ofstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "Error opening trace file: " << path << std::endl;
+            return;
+        }
+        recorder->write(file);
+    }
+
+private:
+    std::string path;
+    std::unique_ptr<trace::Recorder> recorder;
+};
+
+void compile_job_streaming(const CompileJob &job, const OptOptions &options, CompileCache *cache, bool run,
+                           std::ostream &diagnostics, bool &failed) {
+    std::unique_ptr<std::FILE, int (*)(std::FILE *)> input(std::fopen(job.input_path.c_str(), "rb"), std::fclose);
+    try {
+        if (!input)
+            throw std::runtime_error("cannot open input file");
+        std::optional<std::string> key;
+        std::optional<std::string> cached;
+        if (cache) {
+            trace::Span span("cache_lookup");
+            // hashed in chunks like the compilation reads it, the source is never held in memory
+            key = cache->key(input.get(), options, true);
+            if (key)
+                cached = cache->lookup(*key);
+        }
+        {
+            std::ofstream outfile(job.output_path);
+            if (!outfile.is_open())
+                throw std::runtime_error("cannot open output file " + job.output_path);
+            if (cached) {
+                if (run)
+                    run_assembly(*cached, outfile);
+                else
+                    outfile << *cached;
+                return;
+            }
+            if (run) {
+                // the JIT translates whole programs, the assembly is buffered after all
+                std::ostringstream assembly;
+                compile_stream(input.get(), assembly, options, diagnostics);
+                if (key)
+                    cache->store(*key, assembly.str());
+                run_assembly(assembly.str(), outfile);
+                return;
+            }
+            compile_stream(input.get(), outfile, options, diagnostics);
+        }
+        std::string assembly;
+        if (key && read_file(job.output_path, assembly))
+            cache->store(*key, assembly);
+    } catch (const std::exception &e) {
+        // do not leave the code or output of a prefix of the program behind
+        std::remove(job.output_path.c_str());
+        diagnostics << job.input_path << ": " << e.what() << std::endl;
+        failed = true;
+    }
+}
+
+void print_memory_stats(std::ostream &ostream) {
+    auto counters = memstats::current();
+    ostream << "heap allocations: " << counters.allocations << std::endl
+            << "heap bytes allocated: " << counters.allocated_bytes << std::endl
+            << "peak RSS: " << memstats::peak_rss_kib() << " KiB" << std::endl;
+}
+
+}
+
+namespace {
+
+/// @param source ScanBuffer or std::string_view, see parse_program
+template<typename Source>
+std::unique_ptr<Compiler> parse_and_optimize(Source source, const OptOptions &options, std::ostream &diagnostics) {
+    // Compiler is large and owns the whole program, keep it off the worker stacks
+    auto compiler = std::make_unique<Compiler>();
+    if (options.bounds_check)
+        compiler->enable_bounds_checks();
+    {
+        trace::Span span("parse", compiler.get());
+        parse_program(source, *compiler);
+    }
+    trace::Span span("optimize", compiler.get());
+    compiler->optimize(options, diagnostics);
+    return compiler;
+}
+
+template<typename Source>
+void write_assembly(Source source, std::ostream &out, const OptOptions &options, std::ostream &diagnostics) {
+    auto compiler = parse_and_optimize(source, options, diagnostics);
+    {
+        trace::Span span("write_data_region", compiler.get());
+        compiler->write_data_region(out);
+    }
+    trace::Span span("write_text_region", compiler.get());
+    compiler->write_text_region(out);
+}
+
+template<typename Source>
+void write_object(Source source, std::ostream &out, const OptOptions &options, std::ostream &diagnostics) {
+    auto compiler = parse_and_optimize(source, options, diagnostics);
+    trace::Span span("write_object", compiler.get());
+    compiler->write_object(out);
+}
+
+}
+
+void compile_source(ScanBuffer source, std::ostream &out, const OptOptions &options, std::ostream &diagnostics) {
+    write_assembly(source, out, options, diagnostics);
+}
+
+void compile_source(std::string_view source, std::ostream &out, const OptOptions &options,
+                    std::ostream &diagnostics) {
+    write_assembly(source, out, options, diagnostics);
+}
+
+void compile_object(ScanBuffer source, std::ostream &out, const OptOptions &options, std::ostream &diagnostics) {
+    write_object(source, out, options, diagnostics);
+}
+
+void compile_object(std::string_view source, std::ostream &out, const OptOptions &options,
+                    std::ostream &diagnostics) {
+    write_object(source, out, options, diagnostics);
+}
+
+void run_assembly(const std::string &assembly, std::ostream &out) {
+    trace::Span span("run");
+    std::istringstream listing(assembly);
+    Jit jit;
+    jit.load(listing);
+    try {
+        jit.run(out);
+    } catch (const std::runtime_error &e) {
+        throw std::runtime_error(std::string("runtime error at assembly ") + e.what());
+    }
+}
+
+void compile_stream(std::FILE *input, std::ostream &out, const OptOptions &options, std::ostream &diagnostics) {
+    auto compiler = std::make_unique<Compiler>();
+    if (options.bounds_check)
+        compiler->enable_bounds_checks();
+    compiler->begin_streaming(out, options, diagnostics);
+    trace::Span span("parse", compiler.get());
+    parse_program(input, *compiler);
+    compiler->end_streaming();
+}
+
+int compile_files(const std::vector<CompileJob> &jobs, const OptOptions &options, unsigned thread_count,
+                  bool streaming, CompileCache *cache, OutputKind output) {
+    struct JobResult {
+        std::ostringstream diagnostics;
+        bool failed = false;
+    };
+    std::vector<JobResult> results(jobs.size());
+
+    {
+        ThreadPool pool(std::min<std::size_t>(thread_count == 0 ? std::thread::hardware_concurrency() : thread_count,
+                                              jobs.size()));
+        for (std::size_t i = 0; i < jobs.size(); i++) {
+            pool.submit([&job = jobs[i], &result = results[i], &options, streaming, cache, output] {
+                trace::Span span("compile");
+                span.arg("file", job.input_path);
+                bool run = output == OutputKind::RUN;
+                if (streaming && output != OutputKind::OBJECT) {
+                    compile_job_streaming(job, options, cache, run, result.diagnostics, result.failed);
+                    return;
+                }
+                try {
+                    std::optional<MappedFile> file;
+                    {
+                        trace::Span read_span("read");
+                        file.emplace(job.input_path);
+                    }
+                    ScanBuffer source{file->data(), file->size()};
+                    if (output == OutputKind::OBJECT) {
+                        std::ostringstream object;
+                        compile_object(source, object, options, result.diagnostics);
+                        std::ofstream outfile(job.output_path, std::ios::binary);
+                        if (!outfile.is_open())
+                            throw std::runtime_error("cannot open output file " + job.output_path);
+                        outfile << object.str();
+                        return;
+                    }
+                    std::string assembly = compile_cached(source, options, result.diagnostics, cache);
+
+                    std::ofstream outfile(job.output_path);
+                    if (!outfile.is_open())
+                        throw std::runtime_error("cannot open output file " + job.output_path);
+                    if (run)
+                        run_assembly(assembly, outfile);
+                    else
+                        outfile << assembly;
+                } catch (const std::exception &e) {
+                    if (run)
+                        std::remove(job.output_path.c_str());
+                    result.diagnostics << job.input_path << ": " << e.what() << std::endl;
+                    result.failed = true;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    int failed = 0;
+    for (auto &result: results) {
+        std::cerr << result.diagnostics.str();
+        failed += result.failed;
+    }
+    return failed;
+}
+
+int run_driver(int argc, char **argv) {
+    OptOptions opt_options;
+    bool mem_stats = false;
+    bool streaming = false;
+    const char *outfile_path = nullptr;
+    std::vector<std::string> inputs;
+    std::string out_dir;
+    unsigned thread_count = 0;
+    std::string trace_path;
+    std::string cache_dir;
+    uint64_t cache_size_mib = 256;
+    bool cache_stats = false;
+    OutputKind output = OutputKind::ASSEMBLY;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "-O0" || arg == "-O1" || arg == "-O2") {
+            opt_options.opt_level = arg[2] - '0';
+        } else if (arg == "--dump-ir") {
+            opt_options.dump_ir = true;
+        } else if (arg == "--opt-stats") {
+            opt_options.print_stats = true;
+        } else if (arg == "--bounds-check") {
+            opt_options.bounds_check = true;
+        } else if (arg.rfind("--unroll=", 0) == 0 || arg.rfind("--unroll-budget=", 0) == 0) {
+            std::string value(arg.substr(arg.find('=') + 1));
+            try {
+                (arg[8] == '=' ? opt_options.unroll_factor : opt_options.unroll_budget) = std::stoi(value);
+            } catch (...) {
+                std::cerr << "Invalid value: " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg == "--run" || arg == "--emit-obj") {
+            auto kind = arg == "--run" ? OutputKind::RUN : OutputKind::OBJECT;
+            if (output != OutputKind::ASSEMBLY && output != kind) {
+                std::cerr << "--run and --emit-obj exclude each other" << std::endl;
+                return 1;
+            }
+            output = kind;
+        } else if (arg == "--stream") {
+            streaming = true;
+        } else if (arg == "--mem-stats") {
+            mem_stats = true;
+        } else if (arg.rfind("--trace=", 0) == 0 && arg.size() > 8) {
+            trace_path = arg.substr(8);
+        } else if (arg.rfind("--cache-dir=", 0) == 0 && arg.size() > 12) {
+            cache_dir = arg.substr(12);
+        } else if (arg.rfind("--cache-size=", 0) == 0) {
+            std::string size(arg.substr(13));
+            try {
+                cache_size_mib = std::stoull(size);
+            } catch (...) {
+                std::cerr << "Invalid cache size: " << size << std::endl;
+                return 1;
+            }
+        } else if (arg == "--cache-stats") {
+            cache_stats = true;
+        } else if (arg.rfind("-j", 0) == 0) {
+            std::string count = arg.size() > 2 ? std::string(arg.substr(2)) : (i + 1 < argc ? argv[++i] : "");
+            try {
+                thread_count = unsigned(std::stoul(count));
+            } catch (...) {
+                std::cerr << "Invalid thread count: " << count << std::endl;
+                return 1;
+            }
+        } else if (arg == "--out-dir" && i + 1 < argc) {
+            out_dir = argv[++i];
+        } else if (arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(std::cerr);
+            return 1;
+        } else if (has_suffix(arg, ".t")) {
+            inputs.emplace_back(arg);
+        } else {
+            outfile_path = argv[i];
+        }
+    }
+
+    if (streaming && output == OutputKind::OBJECT) {
+        std::cerr << "An object needs the whole program, --stream can not be combined with --emit-obj" << std::endl;
+        return 1;
+    }
+    bool run = output == OutputKind::RUN;
+
+    TraceSession trace_session(trace_path);
+
+    // a hit has no IR dumps or pass statistics to print, so requesting them bypasses the cache
+    std::unique_ptr<CompileCache> cache;
+    if (!cache_dir.empty() && !opt_options.dump_ir && !opt_options.print_stats) {
+        try {
+            cache = std::make_unique<CompileCache>(cache_dir, cache_size_mib << 20);
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    auto finish = [&](int status) {
+        if (cache) {
+            auto stats = cache->commit();
+            if (cache_stats)
+                print_cache_stats(std::cerr, stats, cache->size_limit());
+        }
+        if (mem_stats)
+            print_memory_stats(std::cerr);
+        return status;
+    };
+
+    if (!inputs.empty()) {
+        if (outfile_path != nullptr) {
+            std::cerr << "Output path can only be given when compiling stdin, use --out-dir" << std::endl;
+            return 1;
+        }
+        const char *extension = run ? ".out" : output == OutputKind::OBJECT ? ".o" : ".s";
+        std::vector<CompileJob> jobs;
+        for (auto &input: inputs)
+            jobs.push_back({input, output_path_for(input, out_dir, extension)});
+        int failed = compile_files(jobs, opt_options, thread_count, streaming, cache.get(), output);
+        return finish(failed == 0 ? 0 : 1);
+    }
+
+    if (streaming) {
+        std::ofstream outfile;
+        if (outfile_path != nullptr) {
+            outfile.open(outfile_path);
+            if (!outfile.is_open()) {
+                std::cerr << "Error opening output file: " << outfile_path << std::endl;
+                return 1;
+            }
+        }
+        std::ostream &out = outfile_path == nullptr ? std::cout : outfile;
+        // stdin can not be read twice, so it is compiled without hashing it first and not cached
+        try {
+            trace::Span span("compile");
+            if (run) {
+                std::ostringstream assembly;
+                compile_stream(stdin, assembly, opt_options, std::cerr);
+                run_assembly(assembly.str(), out);
+            } else {
+                compile_stream(stdin, out, opt_options, std::cerr);
+            }
+        } catch (const std::exception &e) {
+            out.flush();
+            std::cerr << e.what() << std::endl;
+            return finish(1);
+        }
+        return finish(0);
+    }
+
+    trace::Span span("compile");
+    std::string text;
+    {
+        trace::Span read_span("read");
+        text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>{});
+    }
+    // NUL bytes the scanner needs to work on the text in place
+    text.append(2, '\0');
+    ScanBuffer source{text.data(), text.size() - 2};
+    std::string compiled; // assembly or object
+    try {
+        if (output == OutputKind::OBJECT) {
+            // the object is written at once, a failed compilation leaves no partial file
+            std::ostringstream object;
+            compile_object(source, object, opt_options, std::cerr);
+            compiled = object.str();
+        } else {
+            compiled = compile_cached(source, opt_options, std::cerr, cache.get());
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return finish(1);
+    }
+
+    std::ofstream outfile;
+    if (outfile_path != nullptr) {
+        outfile.open(outfile_path, std::ios::binary);
+        if (!outfile.is_open()) {
+            std::cerr << "Error opening output file: " << outfile_path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = outfile_path == nullptr ? std::cout : outfile;
+    if (!run) {
+        out << compiled;
+        return finish(0);
+    }
+    try {
+        run_assembly(compiled, out);
+    } catch (const std::exception &e) {
+        out.flush();
+        std::cerr << e.what() << std::endl;
+        return finish(1);
+    }
+    return finish(0);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Parser.hpp"
+#include "PassManager.hpp"
+
+class CompileCache;
+
+/// @brief Compiles one program with a fresh Compiler instance, scanning source in place
+/// @param diagnostics receives IR dumps and optimization statistics
+/// @throws std::runtime_error on lexical, syntax and semantic errors
+void compile_source(ScanBuffer source, std::ostream &out, const OptOptions &options, std::ostream &diagnostics);
+
+/// @brief Same as above for a source the scanner copies first
+void compile_source(std::string_view source, std::ostream &out, const OptOptions &options,
+                    std::ostream &diagnostics);
+
+/// @brief Compiles one program with a fresh Compiler instance to a relocatable MIPS ELF object
+/// @throws std::runtime_error as compile_source
+void compile_object(ScanBuffer source, std::ostream &out, const OptOptions &options, std::ostream &diagnostics);
+
+/// @brief Same as above for a source the scanner copies first
+void compile_object(std::string_view source, std::ostream &out, const OptOptions &options,
+                    std::ostream &diagnostics);
+
+/// @brief Compiles one program read from input, writing the code of every top-level statement
+/// to out as soon as it is parsed, so memory use does not depend on the program length
+/// @throws std::runtime_error as compile_source, out then holds the code of the statements before the error
+void compile_stream(std::FILE *input, std::ostream &out, const OptOptions &options, std::ostream &diagnostics);
+
+struct CompileJob {
+    std::string input_path;
+    std::string output_path;
+};
+
+/// @brief What the driver writes for a program
+enum class OutputKind {
+    ASSEMBLY,
+    OBJECT, // relocatable MIPS ELF object, neither streamed nor cached
+    RUN,    // what the program prints when executed with the JIT
+};
+
+/// @brief Compiles every job on a thread pool, each output is written to its own file.
+/// Inputs are mapped into memory and scanned in place, unless they are streamed.
+/// Diagnostics and errors are printed to stderr in job order once all jobs finished.
+/// @param streaming compile with compile_stream instead of buffering each program
+/// @param cache when given, outputs of unchanged sources are copied from it instead of compiled
+/// @param output OutputKind::OBJECT can not be streamed, streaming is ignored for it
+/// @return number of failed jobs
+int compile_files(const std::vector<CompileJob> &jobs, const OptOptions &options, unsigned thread_count,
+                  bool streaming = false, CompileCache *cache = nullptr, OutputKind output = OutputKind::ASSEMBLY);
+
+/// @brief Executes compiled assembly in process with the x86-64 JIT
+/// @throws std::runtime_error on runtime faults, out then holds what the program printed before
+void run_assembly(const std::string &assembly, std::ostream &out);
+
+/// @brief Command line entry point
+int run_driver(int argc, char **argv);
@@ -1,63 +1,378 @@
 #pragma once
+#include <algorithm>
 #include <cstdint>
-#include <unordered_map>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
-template<typename TKey, typename TValue>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/// @brief Transparent hash of std::string, std::string_view and C strings, lets string keyed maps
+/// be queried with a std::string_view without building a temporary key
+struct StringHash {
+    using is_transparent = void;
+
+    std::size_t operator()(std::string_view text) const noexcept { return std::hash<std::string_view>{}(text); }
+};
+
+template<typename TKey>
+struct DefaultHash : std::hash<TKey> {};
+
+template<>
+struct DefaultHash<std::string> : StringHash {};
+
+template<>
+struct DefaultHash<std::string_view> : StringHash {};
+
+/// @brief Open addressing hash map. Entries live in insertion order in a deque, so references
+/// stay valid across inserts and iteration order does not depend on hashes. The index is a flat
+/// array of one control byte per slot (7 hash bits or empty/deleted) probed 16 slots at a time,
+/// with a parallel array pointing at the entries.
+template<typename TKey, typename TValue, typename THash = DefaultHash<TKey>, typename TEq = std::equal_to<>>
 class HashMap {
+    using Entries = std::deque<std::pair<const TKey, TValue>>;
+
+    template<typename H, typename = void>
+    struct is_transparent : std::false_type {};
+
+    template<typename H>
+    struct is_transparent<H, std::void_t<typename H::is_transparent>> : std::true_type {};
+
+    /// Overloads taking other key types than TKey exist only for transparent hashes
+    template<typename K>
+    using if_transparent = std::enable_if_t<is_transparent<THash>::value && !std::is_same_v<K, TKey>, int>;
+
 public:
+    using value_type = std::pair<const TKey, TValue>;
+
+    template<typename TEntryIt, typename TEntry>
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = HashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = TEntry *;
+        using reference = TEntry &;
+
+        Iterator(TEntryIt entry, const uint8_t *alive, const uint8_t *alive_end)
+            : entry(entry), alive(alive), alive_end(alive_end) { skip_erased(); }
+
+        reference operator*() const { return *entry; }
+
+        pointer operator->() const { return &*entry; }
+
+        Iterator &operator++() {
+            ++entry;
+            ++alive;
+            skip_erased();
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const { return alive == other.alive; }
+
+        bool operator!=(const Iterator &other) const { return alive != other.alive; }
+
+    private:
+        void skip_erased() {
+            while (alive != alive_end && !*alive) {
+                ++entry;
+                ++alive;
+            }
+        }
+
+        TEntryIt entry;
+        const uint8_t *alive;
+        const uint8_t *alive_end;
+    };
+
+    using iterator = Iterator<typename Entries::iterator, value_type>;
+    using const_iterator = Iterator<typename Entries::const_iterator, const value_type>;
+
+    HashMap() = default;
+
+    /// The index points into entries, so a copy rebuilds it over its own entries
+    HashMap(const HashMap &other) : entries(other.entries), alive(other.alive), live_count(other.live_count) {
+        rehash(other.ctrl.size());
+    }
+
+    HashMap(HashMap &&other) noexcept = default;
+
+    HashMap &operator=(const HashMap &other) {
+        if (this != &other)
+            *this = HashMap(other);
+        return *this;
+    }
+
+    HashMap &operator=(HashMap &&other) noexcept = default;
+
     TValue &at(const TKey &key) {
-        return map.at(key);
+        return checked(lookup(key));
     }
 
     const TValue &at(const TKey &key) const {
-        return map.at(key);
+        return checked(const_cast<HashMap *>(this)->lookup(key));
+    }
+
+    template<typename K, if_transparent<K> = 0>
+    TValue &at(const K &key) {
+        return checked(lookup(key));
+    }
+
+    template<typename K, if_transparent<K> = 0>
+    const TValue &at(const K &key) const {
+        return checked(const_cast<HashMap *>(this)->lookup(key));
     }
 
     bool contains(const TKey &key) const {
-        return map.find(key) != map.end();
+        return const_cast<HashMap *>(this)->lookup(key) != nullptr;
     }
 
-    TValue &operator [] (const TKey &key) {
-        return map[key];
+    template<typename K, if_transparent<K> = 0>
+    bool contains(const K &key) const {
+        return const_cast<HashMap *>(this)->lookup(key) != nullptr;
     }
 
-    const TValue & operator [] (const TKey &key) const {
-        return map[key];
+    TValue &operator [] (const TKey &key) {
+        if (auto *value = lookup(key))
+            return *value;
+        return emplace_new(key, TValue{});
     }
 
     std::optional<TValue*> find(const TKey &key) {
-        auto it = map.find(key);
-        if (it != map.end()) {
-            return &it->second;
-        }
-        return std::nullopt;
+        return found(lookup(key));
+    }
+
+    template<typename K, if_transparent<K> = 0>
+    std::optional<TValue*> find(const K &key) {
+        return found(lookup(key));
+    }
+
+    std::optional<const TValue*> find(const TKey &key) const {
+        return const_cast<HashMap *>(this)->find(key);
     }
 
+    template<typename K, if_transparent<K> = 0>
+    std::optional<const TValue*> find(const K &key) const {
+        return const_cast<HashMap *>(this)->find(key);
+    }
+
+    /// @brief Inserts the pair unless the key is already present, like std::unordered_map::insert
     void insert(const TKey &key, TValue &&value) {
-        map.insert(std::make_pair(key, std::move(value)));
+        if (lookup(key) == nullptr)
+            emplace_new(key, std::move(value));
     }
 
     void erase(const TKey &key) {
-        map.erase(key);
+        std::size_t hash = mix(THash{}(key));
+        std::size_t slot = probe(key, hash);
+        if (slot == NPOS)
+            return;
+        alive[slots[slot].index] = 0;
+        ctrl[slot] = DELETED;
+        live_count--;
     }
 
     size_t size() const {
-        return map.size();
+        return live_count;
     }
 
     bool empty() const {
-        return map.empty();
+        return live_count == 0;
     }
 
     void clear() {
-        map.clear();
+        entries.clear();
+        alive.clear();
+        ctrl.clear();
+        slots.clear();
+        live_count = 0;
+        used_slots = 0;
+    }
+
+    /// @brief Drops the storage of erased entries once they outnumber the live ones.
+    /// Unlike the other operations this invalidates references to entries and insertion marks.
+    void compact() {
+        if (entries.size() - live_count <= live_count)
+            return;
+        Entries kept;
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            if (alive[i])
+                kept.emplace_back(entries[i].first, std::move(entries[i].second));
+        }
+        entries = std::move(kept);
+        alive.assign(entries.size(), 1);
+        rehash(ctrl.size());
     }
 
-    typename std::unordered_map<TKey, TValue>::iterator begin() { return map.begin(); }
-    typename std::unordered_map<TKey, TValue>::iterator end() { return map.end(); }
-    typename std::unordered_map<TKey, TValue>::const_iterator begin() const { return map.begin(); }
-    typename std::unordered_map<TKey, TValue>::const_iterator end() const { return map.end(); }
+    /// @return position after the last inserted entry, since() visits only the entries inserted later
+    std::size_t insertion_mark() const {
+        return entries.size();
+    }
+
+    iterator since(std::size_t mark) {
+        return {entries.begin() + mark, alive.data() + mark, alive.data() + alive.size()};
+    }
+
+    /// @return number of lookups by key so far, for tracing
+    std::size_t lookup_count() const {
+        return lookups;
+    }
+
+    /// @brief Makes room for count entries without rehashing
+    void reserve(std::size_t count) {
+        std::size_t capacity = GROUP;
+        while (capacity * 7 / 8 < count)
+            capacity *= 2;
+        if (capacity > ctrl.size())
+            rehash(capacity);
+    }
+
+    iterator begin() { return {entries.begin(), alive.data(), alive.data() + alive.size()}; }
+    iterator end() { return {entries.end(), alive.data() + alive.size(), alive.data() + alive.size()}; }
+    const_iterator begin() const { return {entries.begin(), alive.data(), alive.data() + alive.size()}; }
+    const_iterator end() const { return {entries.end(), alive.data() + alive.size(), alive.data() + alive.size()}; }
 
 private:
-    std::unordered_map<TKey, TValue> map;
+    static constexpr std::size_t GROUP = 16;
+    static constexpr std::size_t NPOS = ~std::size_t(0);
+    static constexpr uint8_t EMPTY = 0x80;
+    static constexpr uint8_t DELETED = 0xFE;
+
+    /// @brief Spreads weak hashes (std::hash of integers is the identity) over all bits,
+    /// the low bits pick the group and the top 7 bits are stored in the control byte
+    static std::size_t mix(std::size_t hash) {
+        return std::size_t(uint64_t(hash) * 0x9E3779B97F4A7C15ull);
+    }
+
+    static uint8_t fragment(std::size_t hash) {
+        return uint8_t(uint64_t(hash) >> 57);
+    }
+
+    /// @return bit i set when control byte i of the group equals byte
+    static uint32_t match(const uint8_t *group, uint8_t byte) {
+#if defined(__SSE2__)
+        __m128i ctrl_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+        return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_bytes, _mm_set1_epi8(char(byte)))));
+#else
+        uint32_t mask = 0;
+        for (std::size_t i = 0; i < GROUP; i++)
+            mask |= uint32_t(group[i] == byte) << i;
+        return mask;
+#endif
+    }
+
+    static int lowest_bit(uint32_t mask) {
+        return __builtin_ctz(mask);
+    }
+
+    /// @return index slot holding key, NPOS when absent
+    template<typename K>
+    std::size_t probe(const K &key, std::size_t hash) const {
+        if (ctrl.empty())
+            return NPOS;
+        std::size_t mask = ctrl.size() - 1;
+        uint8_t frag = fragment(hash);
+        std::size_t group = hash & mask & ~(GROUP - 1);
+        for (std::size_t step = GROUP;; step += GROUP) {
+            const uint8_t *bytes = ctrl.data() + group;
+            for (uint32_t hits = match(bytes, frag); hits != 0; hits &= hits - 1) {
+                std::size_t slot = group + lowest_bit(hits);
+                if (TEq{}(slots[slot].entry->first, key))
+                    return slot;
+            }
+            if (match(bytes, EMPTY) != 0)
+                return NPOS;
+            group = (group + step) & mask;
+        }
+    }
+
+    static TValue &checked(TValue *value) {
+        if (value == nullptr)
+            throw std::out_of_range("HashMap::at");
+        return *value;
+    }
+
+    static std::optional<TValue*> found(TValue *value) {
+        if (value == nullptr)
+            return std::nullopt;
+        return value;
+    }
+
+    template<typename K>
+    TValue *lookup(const K &key) {
+        lookups++;
+        std::size_t slot = probe(key, mix(THash{}(key)));
+        return slot == NPOS ? nullptr : &slots[slot].entry->second;
+    }
+
+    /// @return first empty or deleted slot on the probe sequence of hash
+    std::size_t free_slot(std::size_t hash) const {
+        std::size_t mask = ctrl.size() - 1;
+        std::size_t group = hash & mask & ~(GROUP - 1);
+        for (std::size_t step = GROUP;; step += GROUP) {
+            const uint8_t *bytes = ctrl.data() + group;
+            uint32_t free = match(bytes, EMPTY) | match(bytes, DELETED);
+            if (free != 0)
+                return group + lowest_bit(free);
+            group = (group + step) & mask;
+        }
+    }
+
+    TValue &emplace_new(const TKey &key, TValue &&value) {
+        if ((used_slots + 1) * 8 > ctrl.size() * 7) {
+            // Mostly tombstones: clean up in place, otherwise grow
+            bool crowded = (live_count + 1) * 16 > ctrl.size() * 7;
+            rehash(crowded ? std::max(GROUP, ctrl.size() * 2) : ctrl.size());
+        }
+
+        std::size_t hash = mix(THash{}(key));
+        std::size_t slot = free_slot(hash);
+        if (ctrl[slot] == EMPTY)
+            used_slots++;
+        ctrl[slot] = fragment(hash);
+        auto &entry = entries.emplace_back(key, std::move(value));
+        slots[slot] = {&entry, uint32_t(entries.size() - 1)};
+        alive.push_back(1);
+        live_count++;
+        return entries.back().second;
+    }
+
+    /// @brief Rebuilds the index with capacity slots, dropping tombstones
+    void rehash(std::size_t capacity) {
+        ctrl.assign(capacity, EMPTY);
+        slots.assign(capacity, {});
+        used_slots = 0;
+        for (std::size_t i = 0; i < entries.size(); i++) {
+            if (!alive[i])
+                continue;
+            std::size_t hash = mix(THash{}(entries[i].first));
+            std::size_t slot = free_slot(hash);
+            ctrl[slot] = fragment(hash);
+            slots[slot] = {&entries[i], uint32_t(i)};
+            used_slots++;
+        }
+    }
+
+    struct Slot {
+        value_type *entry;
+        uint32_t index;
+    };
+
+    Entries entries;
+    std::vector<uint8_t> alive;
+    std::vector<uint8_t> ctrl;
+    std::vector<Slot> slots;
+    std::size_t live_count = 0;
+    std::size_t used_slots = 0;
+    std::size_t lookups = 0;
 };
@@ -0,0 +1,17 @@
+#include "Interner.hpp"
+
+Interner::Interner() {
+    symbols.push_back(Symbol());
+    index.insert(std::string_view(), 0);
+}
+
+Symbol Interner::intern(std::string_view text) {
+    if (auto found = index.find(text))
+        return symbols[*found.value()];
+
+    auto id = uint32_t(symbols.size());
+    auto stored = storage.copy(text);
+    symbols.push_back(Symbol(id, stored));
+    index.insert(stored, uint32_t(id));
+    return symbols.back();
+}
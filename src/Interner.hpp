@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Arena.hpp"
+#include "HashMap.hpp"
+
+/// @brief Handle of a string interned by Interner. Equal strings of one interner share the id,
+/// so comparison and hashing never touch the characters. Default constructed symbol is "".
+class Symbol {
+public:
+    Symbol() = default;
+
+    uint32_t id() const { return symbol_id; }
+
+    std::string_view str() const { return {text, length}; }
+
+    operator std::string_view() const { return str(); }
+
+    std::string string() const { return std::string(str()); }
+
+    bool empty() const { return length == 0; }
+
+    bool starts_with(std::string_view prefix) const { return str().substr(0, prefix.size()) == prefix; }
+
+    char operator[](std::size_t idx) const { return text[idx]; }
+
+    bool operator==(const Symbol &other) const { return symbol_id == other.symbol_id; }
+
+    bool operator!=(const Symbol &other) const { return symbol_id != other.symbol_id; }
+
+private:
+    friend class Interner;
+
+    Symbol(uint32_t id, std::string_view text) : symbol_id(id), length(uint32_t(text.size())), text(text.data()) {}
+
+    uint32_t symbol_id = 0;
+    uint32_t length = 0;
+    const char *text = "";
+};
+
+inline std::ostream &operator<<(std::ostream &ostream, const Symbol &symbol) {
+    return ostream << symbol.str();
+}
+
+namespace std {
+template<>
+struct hash<Symbol> {
+    std::size_t operator()(const Symbol &symbol) const noexcept { return symbol.id(); }
+};
+}
+
+/// @brief Arena backed string table of one compilation, identifiers, literals and
+/// generated names are stored once and referred to by Symbol
+class Interner {
+public:
+    Interner();
+
+    Interner(const Interner &) = delete;
+
+    Interner &operator=(const Interner &) = delete;
+
+    Symbol intern(std::string_view text);
+
+    /// @return symbol of the id returned by Symbol::id()
+    Symbol get(uint32_t id) const { return symbols[id]; }
+
+    std::size_t size() const { return symbols.size(); }
+
+    const Arena &arena() const { return storage; }
+
+private:
+    Arena storage;
+    std::vector<Symbol> symbols;
+    HashMap<std::string_view, uint32_t> index;
+};
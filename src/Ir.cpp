@@ -0,0 +1,331 @@
+#include "Ir.hpp"
+
+#include <cassert>
+#include <cctype>
+#include <stdexcept>
+
+namespace ir {
+
+Operand::Operand(std::string text) : text(std::move(text)) {
+    assert(!this->text.empty());
+    char c = this->text[0];
+    if (c == '$') {
+        kind = Kind::REG;
+    } else if (c == '(') {
+        assert(this->text.back() == ')');
+        kind = Kind::MEM;
+        this->text = this->text.substr(1, this->text.size() - 2);
+    } else if (std::isdigit(static_cast<unsigned char>(c)) || c == '-') {
+        kind = Kind::IMM;
+    } else {
+        kind = Kind::SYMBOL;
+    }
+}
+
+Operand::Operand(const char *text) : Operand(std::string(text)) {}
+
+Operand::Operand(Symbol symbol) : Operand(symbol.string()) {}
+
+Operand::Operand(const Reg &reg) : kind(Kind::REG), text(reg.str()) {}
+
+Operand::Operand(int value) : kind(Kind::IMM), text(std::to_string(value)) {}
+
+Operand Operand::mem(const std::string &base_reg) {
+    Operand op;
+    op.kind = Kind::MEM;
+    op.text = base_reg;
+    return op;
+}
+
+std::string Operand::str() const {
+    if (kind == Kind::MEM)
+        return "(" + text + ")";
+    return text;
+}
+
+static const std::unordered_map<std::string_view, OpInfo> &op_table() {
+    using K = OpInfo::Kind;
+    static const std::unordered_map<std::string_view, OpInfo> table = {
+        {"li", {K::ARITHMETIC}},
+        {"la", {K::ARITHMETIC}},
+        {"move", {K::ARITHMETIC}},
+        {"mov.s", {K::ARITHMETIC}},
+        {"add", {K::ARITHMETIC, 0, true}},
+        {"sub", {K::ARITHMETIC, 0, true}},
+        {"mul", {K::ARITHMETIC}},
+        {"div", {K::ARITHMETIC, 0, true}},
+        {"addi", {K::ARITHMETIC, 0, true}},
+        {"subi", {K::ARITHMETIC, 0, true}},
+        {"sll", {K::ARITHMETIC}},
+        {"add.s", {K::ARITHMETIC}},
+        {"sub.s", {K::ARITHMETIC}},
+        {"mul.s", {K::ARITHMETIC}},
+        {"div.s", {K::ARITHMETIC}},
+        {"mtc1", {K::ARITHMETIC, 1}},
+        {"mfc1", {K::ARITHMETIC}},
+        {"cvt.s.w", {K::ARITHMETIC}},
+        {"cvt.w.s", {K::ARITHMETIC}},
+        {"lw", {K::LOAD}},
+        {"l.s", {K::LOAD}},
+        {"sw", {K::STORE, -1}},
+        {"s.s", {K::STORE, -1}},
+        {"c.eq.s", {K::COMPARE, -1}},
+        {"c.lt.s", {K::COMPARE, -1}},
+        {"c.le.s", {K::COMPARE, -1}},
+        {"beq", {K::BRANCH, -1}},
+        {"bne", {K::BRANCH, -1}},
+        {"blt", {K::BRANCH, -1}},
+        {"ble", {K::BRANCH, -1}},
+        {"bgt", {K::BRANCH, -1}},
+        {"bge", {K::BRANCH, -1}},
+        {"bgeu", {K::BRANCH, -1}},
+        {"beqz", {K::BRANCH, -1}},
+        {"bnez", {K::BRANCH, -1}},
+        {"bc1t", {K::BRANCH, -1}},
+        {"bc1f", {K::BRANCH, -1}},
+        {"b", {K::JUMP, -1}},
+        {"syscall", {K::SYSCALL, -1}},
+    };
+    return table;
+}
+
+Instr::Instr(std::string opcode, std::vector<Operand> operands)
+    : opcode(std::move(opcode)), operands(std::move(operands)) {}
+
+const OpInfo &Instr::info() const {
+    auto &table = op_table();
+    auto it = table.find(opcode);
+    if (it == table.end())
+        throw std::runtime_error("unknown opcode: " + opcode);
+    return it->second;
+}
+
+bool Instr::is_branch() const {
+    return info().kind == OpInfo::Kind::BRANCH;
+}
+
+bool Instr::is_jump() const {
+    return info().kind == OpInfo::Kind::JUMP;
+}
+
+bool Instr::is_load() const {
+    return info().kind == OpInfo::Kind::LOAD;
+}
+
+bool Instr::is_store() const {
+    return info().kind == OpInfo::Kind::STORE;
+}
+
+const std::string &Instr::target() const {
+    assert(is_terminator() && !operands.empty());
+    return operands.back().text;
+}
+
+std::vector<std::string> Instr::defs() const {
+    auto &op_info = info();
+    std::vector<std::string> regs;
+    if (op_info.kind == OpInfo::Kind::COMPARE)
+        regs.emplace_back(FLAG_REG);
+    if (op_info.def_operand >= 0 && op_info.def_operand < int(operands.size())
+        && operands[op_info.def_operand].is_reg())
+        regs.push_back(operands[op_info.def_operand].text);
+    return regs;
+}
+
+std::vector<std::string> Instr::uses() const {
+    auto &op_info = info();
+    std::vector<std::string> regs;
+    if (op_info.kind == OpInfo::Kind::SYSCALL)
+        return {"$v0", "$a0", "$f12"};
+    if (opcode == "bc1t" || opcode == "bc1f")
+        regs.emplace_back(FLAG_REG);
+
+    for (int i = 0; i < int(operands.size()); i++) {
+        auto &op = operands[i];
+        if (op.is_mem()) {
+            regs.push_back(op.text);
+        } else if (op.is_reg() && i != op_info.def_operand) {
+            regs.push_back(op.text);
+        }
+    }
+    return regs;
+}
+
+bool Instr::may_trap() const {
+    if (info().traps)
+        return true;
+    return (is_load() || is_store()) && operands.size() > 1 && operands[1].is_mem();
+}
+
+bool Instr::has_side_effects() const {
+    auto kind = info().kind;
+    return (kind != OpInfo::Kind::ARITHMETIC && kind != OpInfo::Kind::LOAD && kind != OpInfo::Kind::COMPARE)
+           || may_trap();
+}
+
+std::string Instr::str() const {
+    std::string s = opcode;
+    for (std::size_t i = 0; i < operands.size(); i++) {
+        s += i == 0 ? " " : ", ";
+        s += operands[i].str();
+    }
+    return s;
+}
+
+std::string_view inverted_branch(std::string_view opcode) {
+    static const std::unordered_map<std::string_view, std::string_view> inverse = {
+        {"beq", "bne"}, {"bne", "beq"},
+        {"blt", "bge"}, {"bge", "blt"},
+        {"ble", "bgt"}, {"bgt", "ble"},
+        {"beqz", "bnez"}, {"bnez", "beqz"},
+        {"bc1t", "bc1f"}, {"bc1f", "bc1t"},
+    };
+    auto it = inverse.find(opcode);
+    return it == inverse.end() ? std::string_view() : it->second;
+}
+
+int additive_sign(std::string_view opcode) {
+    if (opcode == "add" || opcode == "addi")
+        return 1;
+    if (opcode == "sub" || opcode == "subi")
+        return -1;
+    return 0;
+}
+
+bool is_copy(std::string_view opcode) {
+    return opcode == "move" || opcode == "mov.s";
+}
+
+bool is_float_access(std::string_view opcode) {
+    return opcode == "l.s" || opcode == "s.s";
+}
+
+bool is_commutative(std::string_view opcode) {
+    return opcode == "add" || opcode == "mul" || opcode == "add.s" || opcode == "mul.s";
+}
+
+bool BasicBlock::falls_through() const {
+    return instrs.empty() || !instrs.back().is_jump();
+}
+
+Program::Program() : blocks(1) {}
+
+void Program::emit(Instr instr) {
+    if (!block_open) {
+        blocks.emplace_back();
+        block_open = true;
+    }
+    bool terminator = instr.is_terminator();
+    blocks.back().instrs.push_back(std::move(instr));
+    emitted++;
+    if (terminator)
+        block_open = false;
+}
+
+void Program::emit_label(const std::string &label) {
+    if (blocks.back().instrs.empty() && blocks.back().label.empty()) {
+        blocks.back().label = label;
+    } else {
+        blocks.push_back({label, {}});
+    }
+    block_open = true;
+}
+
+int Program::find_block(std::string_view label) const {
+    auto cached = label_index.find(label);
+    if (cached.has_value()) {
+        int block = *cached.value();
+        if (block < int(blocks.size()) && blocks[block].label == label)
+            return block;
+    }
+
+    label_index.clear();
+    for (int i = 0; i < int(blocks.size()); i++) {
+        if (!blocks[i].label.empty())
+            label_index[blocks[i].label] = i;
+    }
+    cached = label_index.find(label);
+    return cached.has_value() ? *cached.value() : -1;
+}
+
+std::vector<int> Program::successors(int block) const {
+    std::vector<int> succs;
+    auto &bb = blocks[block];
+    if (!bb.instrs.empty() && bb.instrs.back().is_terminator()) {
+        int target = find_block(bb.instrs.back().target());
+        if (target >= 0)
+            succs.push_back(target);
+    }
+    if (bb.falls_through() && block + 1 < int(blocks.size())) {
+        if (succs.empty() || succs[0] != block + 1)
+            succs.push_back(block + 1);
+    }
+    return succs;
+}
+
+std::vector<std::vector<int>> Program::predecessors() const {
+    std::vector<std::vector<int>> preds(blocks.size());
+    for (int i = 0; i < int(blocks.size()); i++) {
+        for (int succ: successors(i))
+            preds[succ].push_back(i);
+    }
+    return preds;
+}
+
+std::size_t Program::instr_count() const {
+    std::size_t count = 0;
+    for (auto &bb: blocks)
+        count += bb.instrs.size();
+    return count;
+}
+
+bool Program::empty() const {
+    for (auto &bb: blocks) {
+        if (!bb.instrs.empty() || !bb.label.empty())
+            return false;
+    }
+    return true;
+}
+
+void Program::remove_empty_blocks() {
+    std::vector<BasicBlock> kept;
+    kept.reserve(blocks.size());
+    for (auto &bb: blocks) {
+        if (bb.instrs.empty() && bb.label.empty())
+            continue;
+        kept.push_back(std::move(bb));
+    }
+    if (kept.empty())
+        kept.emplace_back();
+    blocks = std::move(kept);
+}
+
+void Program::write(std::ostream &ostream) const {
+    for (auto &bb: blocks) {
+        if (!bb.label.empty())
+            ostream << bb.label << ":" << std::endl;
+        for (auto &instr: bb.instrs)
+            ostream << instr.str() << std::endl;
+    }
+}
+
+void Program::dump(std::ostream &ostream) const {
+    auto preds = predecessors();
+    for (int i = 0; i < int(blocks.size()); i++) {
+        auto &bb = blocks[i];
+        ostream << "bb" << i;
+        if (!bb.label.empty())
+            ostream << " <" << bb.label << ">";
+        ostream << "    ; preds:";
+        for (int pred: preds[i])
+            ostream << " bb" << pred;
+        ostream << "  succs:";
+        for (int succ: successors(i))
+            ostream << " bb" << succ;
+        ostream << std::endl;
+        for (auto &instr: bb.instrs)
+            ostream << "    " << instr.str() << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+#include <unordered_map>
+#include <initializer_list>
+
+#include "HashMap.hpp"
+#include "RegisterManager.hpp"
+
+namespace ir {
+
+struct Operand {
+    enum class Kind {
+        REG,
+        IMM,
+        SYMBOL,   // data region symbol or label
+        MEM,      // register indirect memory access, text holds the base register
+    };
+
+    Kind kind = Kind::IMM;
+    std::string text;
+
+    Operand() = default;
+
+    Operand(std::string text);
+
+    Operand(const char *text);
+    Operand(Symbol symbol);
+
+    Operand(const Reg &reg);
+
+    Operand(int value);
+
+    static Operand mem(const std::string &base_reg);
+
+    bool is_reg() const { return kind == Kind::REG; }
+    bool is_imm() const { return kind == Kind::IMM; }
+    bool is_symbol() const { return kind == Kind::SYMBOL; }
+    bool is_mem() const { return kind == Kind::MEM; }
+
+    std::string str() const;
+
+    bool operator==(const Operand &other) const {
+        return kind == other.kind && text == other.text;
+    }
+    bool operator!=(const Operand &other) const {
+        return !(*this == other);
+    }
+};
+
+/// @brief Properties of an opcode used by the optimization passes
+struct OpInfo {
+    enum class Kind {
+        ARITHMETIC, // first operand is the destination
+        LOAD,       // first operand is the destination, second is the address
+        STORE,      // first operand is the stored value, second is the address
+        COMPARE,    // FPU compare, sets the condition flag
+        BRANCH,     // conditional branch, last operand is the target label
+        JUMP,       // unconditional branch
+        SYSCALL,
+    };
+
+    Kind kind;
+    int def_operand = 0; // index of the written operand, -1 if none
+    bool traps = false;  // raises a runtime error on some operands: add and sub on overflow, div by zero
+};
+
+/// @brief Pseudo register standing for the FPU condition flag in defs()/uses()
+inline constexpr std::string_view FLAG_REG = "$fcc";
+
+/// @brief Label of the out of line handler of failed array bounds checks. The handler ends the
+/// program, so passes treat a branch to it as leaving the program rather than as a CFG edge.
+inline constexpr std::string_view BOUNDS_FAIL_LABEL = "__bounds_fail";
+
+struct Instr {
+    std::string opcode;
+    std::vector<Operand> operands;
+
+    Instr() = default;
+
+    Instr(std::string opcode, std::vector<Operand> operands = {});
+
+    const OpInfo &info() const;
+
+    bool is_branch() const;
+
+    bool is_jump() const;
+
+    bool is_terminator() const { return is_branch() || is_jump(); }
+
+    bool is_load() const;
+
+    bool is_store() const;
+
+    /// @return label the branch or jump transfers control to
+    const std::string &target() const;
+
+    /// @return registers written by the instruction
+    std::vector<std::string> defs() const;
+
+    /// @return registers read by the instruction
+    std::vector<std::string> uses() const;
+
+    /// @return true if the instruction may end the program with a runtime error: trapping
+    /// arithmetic and memory accesses through a computed address
+    bool may_trap() const;
+
+    /// @return true if the instruction has effects other than writing its def registers, a
+    /// possible trap included
+    bool has_side_effects() const;
+
+    std::string str() const;
+};
+
+/// @return opcode of the conditional branch taken exactly when given one is not, empty if there is none
+std::string_view inverted_branch(std::string_view opcode);
+
+/// @return 1 for the integer additions add and addi, -1 for the subtractions sub and subi, 0 otherwise
+int additive_sign(std::string_view opcode);
+
+/// @return true for the register copies move and mov.s
+bool is_copy(std::string_view opcode);
+
+/// @return true for the FPU memory accesses l.s and s.s
+bool is_float_access(std::string_view opcode);
+
+/// @return true for the arithmetic whose source operands can be swapped
+bool is_commutative(std::string_view opcode);
+
+struct BasicBlock {
+    std::string label; // empty for blocks entered only by fall-through
+    std::vector<Instr> instrs;
+
+    bool falls_through() const;
+};
+
+/// @brief Whole-program three-address code split into basic blocks, in layout order
+class Program {
+public:
+    Program();
+
+    void emit(Instr instr);
+
+    void emit(const std::string &opcode, std::initializer_list<Operand> operands) {
+        emit(Instr(opcode, operands));
+    }
+
+    void emit_label(const std::string &label);
+
+    /// @return index of the block with given label or -1
+    int find_block(std::string_view label) const;
+
+    /// @return indices of blocks control can reach directly from given block
+    std::vector<int> successors(int block) const;
+
+    std::vector<std::vector<int>> predecessors() const;
+
+    /// @return number of instructions in all blocks
+    std::size_t instr_count() const;
+
+    /// @return number of instructions emitted so far, including the ones passes removed since
+    std::size_t emitted_count() const { return emitted; }
+
+    /// @return true when there is neither an instruction nor a label
+    bool empty() const;
+
+    /// @brief Drops empty unlabeled blocks, has to be called after passes remove instructions
+    void remove_empty_blocks();
+
+    /// @brief Lowers the program to MIPS assembly text
+    void write(std::ostream &ostream) const;
+
+    /// @brief Human readable listing with block boundaries and control flow edges
+    void dump(std::ostream &ostream) const;
+
+public:
+    std::vector<BasicBlock> blocks;
+
+private:
+    bool block_open = true;
+    std::size_t emitted = 0;
+
+    // label -> block index, rebuilt when passes moved blocks around and an entry went stale
+    mutable HashMap<std::string, int> label_index;
+};
+
+}
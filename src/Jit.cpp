@@ -0,0 +1,505 @@
+#include "Jit.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define JIT_SUPPORTED 1
+#endif
+
+using namespace mips;
+
+namespace {
+
+/// @brief cvt.w.s with the simulator's rounding and out of range result
+int32_t convert_to_word(int32_t bits) {
+    float f = as_float(bits);
+    return (std::isnan(f) || f >= 2147483648.0f || f < -2147483648.0f) ? INT32_MAX : int32_t(std::nearbyint(f));
+}
+
+/// @brief SPIM syscall selected by $v0, called from the generated code
+/// @return 0 to continue, 1 to leave the program after exit or with state->fault set
+int32_t handle_syscall(Jit::State *state) {
+    // nothing may unwind through the generated code
+    try {
+        auto &out = *state->out;
+        auto &regs = state->regs;
+        switch (regs[2]) {
+            case 1: out << regs[4]; return 0;
+            case 2: out << as_float(regs[FPR_BASE + 12]); return 0;
+            case 4:
+                for (uint32_t address = uint32_t(regs[4]);; address++) {
+                    if (address < DATA_BASE || address - DATA_BASE >= state->memory_size) {
+                        state->fault = Jit::STRING_OUT_OF_SEGMENT;
+                        return 1;
+                    }
+                    char c = char(state->memory[address - DATA_BASE]);
+                    if (c == '\0')
+                        return 0;
+                    out << c;
+                }
+            case 10: return 1;
+            case 11: out << char(regs[4]); return 0;
+            default:
+                state->fault = Jit::UNSUPPORTED_SYSCALL;
+                return 1;
+        }
+    } catch (...) {
+        state->fault = Jit::OUTPUT_ERROR;
+        return 1;
+    }
+}
+
+enum Reg : uint8_t { EAX = 0, ECX = 1, EDI = 7 };
+
+enum Condition : uint8_t {
+    JO = 0x80, JAE = 0x83, JE = 0x84, JNE = 0x85, JA = 0x87,
+    JL = 0x8C, JGE = 0x8D, JLE = 0x8E, JG = 0x8F,
+};
+
+/// @brief x86-64 code buffer with forward and backward rel32 jumps to labels. rbx points to
+/// Jit::State, the MIPS registers are accessed as [rbx + 4 * index], r15 points to the data
+/// segment.
+class Assembler {
+public:
+    void emit(std::initializer_list<uint8_t> opcode) { bytes.insert(bytes.end(), opcode); }
+
+    void imm32(int32_t value) {
+        for (int i = 0; i < 4; i++)
+            bytes.push_back(uint8_t(uint32_t(value) >> (8 * i)));
+    }
+
+    void imm64(uint64_t value) {
+        for (int i = 0; i < 8; i++)
+            bytes.push_back(uint8_t(value >> (8 * i)));
+    }
+
+    int new_label() {
+        labels.push_back(-1);
+        return int(labels.size()) - 1;
+    }
+
+    void bind(int label) { labels[label] = long(bytes.size()); }
+
+    /// @param condition Jcc opcode byte, 0 for an unconditional jmp
+    void jump(uint8_t condition, int label) {
+        if (condition == 0)
+            emit({0xE9});
+        else
+            emit({0x0F, condition});
+        fixups.emplace_back(bytes.size(), label);
+        imm32(0);
+    }
+
+    /// @brief Resolves the jumps, every label used must be bound
+    void patch() {
+        for (auto [at, label]: fixups) {
+            int32_t rel = int32_t(labels[label] - long(at + 4));
+            std::memcpy(&bytes[at], &rel, sizeof(rel));
+        }
+    }
+
+    /// @brief ModRM and displacement of x86 register op [rbx + offset]
+    void state_operand(uint8_t x86, std::size_t offset) {
+        emit({uint8_t(0x83 | x86 << 3)});
+        imm32(int32_t(offset));
+    }
+
+    /// @brief ModRM and displacement of x86 register op MIPS register reg
+    void reg_operand(uint8_t x86, int reg) { state_operand(x86, offsetof(Jit::State, regs) + 4 * reg); }
+
+    /// @brief mov dword [rbx + offset], value
+    void store_state(std::size_t offset, int32_t value) {
+        emit({0xC7});
+        state_operand(0, offset);
+        imm32(value);
+    }
+
+    void load(uint8_t x86, int reg) {
+        emit({0x8B});
+        reg_operand(x86, reg);
+    }
+
+    /// @brief Writes of $zero are dropped, it reads as zero
+    void store(int reg, uint8_t x86) {
+        if (reg == 0)
+            return;
+        emit({0x89});
+        reg_operand(x86, reg);
+    }
+
+    void store_imm(int reg, int32_t value) {
+        if (reg == 0)
+            return;
+        store_state(offsetof(Jit::State, regs) + 4 * reg, value);
+    }
+
+    /// @brief SSE instruction F3 0F opcode xmm, [reg]
+    void sse(uint8_t opcode, uint8_t xmm, int reg) {
+        emit({0xF3, 0x0F, opcode});
+        reg_operand(xmm, reg);
+    }
+
+    void call(const void *function) {
+        emit({0x48, 0xB8}); // mov rax, imm64
+        imm64(reinterpret_cast<uint64_t>(function));
+        emit({0xFF, 0xD0}); // call rax
+    }
+
+    std::vector<uint8_t> bytes;
+
+private:
+    std::vector<long> labels;
+    std::vector<std::pair<std::size_t, int>> fixups;
+};
+
+/// @brief Translates a listing, one x86 sequence per MIPS instruction
+class Translator {
+public:
+    Translator(const std::vector<Instruction> &text, uint32_t memory_size)
+        : text(text), memory_size(memory_size) {}
+
+    std::vector<uint8_t> translate() {
+        for (std::size_t i = 0; i <= text.size(); i++)
+            as.new_label();
+        epilogue = int(text.size());
+
+        as.emit({0x53, 0x41, 0x57, 0x55});       // push rbx; push r15; push rbp (aligns the stack)
+        as.emit({0x48, 0x89, 0xFB});             // mov rbx, rdi
+        as.emit({0x49, 0x89, 0xF7});             // mov r15, rsi
+        for (std::size_t i = 0; i < text.size(); i++) {
+            as.bind(int(i));
+            translate(text[i]);
+        }
+        as.bind(epilogue);
+        as.emit({0x5D, 0x41, 0x5F, 0x5B, 0xC3}); // pop rbp; pop r15; pop rbx; ret
+
+        for (auto &stub: stubs) {
+            as.bind(stub.label);
+            // NONE after a syscall, which set the fault itself
+            if (stub.fault != Jit::NONE)
+                as.store_state(offsetof(Jit::State, fault), stub.fault);
+            as.store_state(offsetof(Jit::State, fault_line), stub.line);
+            as.jump(0, epilogue);
+        }
+        as.patch();
+        return std::move(as.bytes);
+    }
+
+private:
+    struct Stub {
+        int label;
+        Jit::Fault fault;
+        int line;
+    };
+
+    /// @return label of code leaving the program with given fault
+    int fault(Jit::Fault fault, int line) {
+        int label = as.new_label();
+        stubs.push_back({label, fault, line});
+        return label;
+    }
+
+    int target(const Operand &op) const {
+        return op.value >= 0 && std::size_t(op.value) < text.size() ? op.value : epilogue;
+    }
+
+    /// @brief eax op= operand, op is the x86 ALU opcode with a register destination
+    void alu(uint8_t op, const Operand &operand) {
+        if (operand.kind == OperandKind::REG) {
+            as.emit({op});
+            as.reg_operand(EAX, operand.reg);
+        } else {
+            as.emit({uint8_t(op + 2)}); // the eax, imm32 form
+            as.imm32(operand.value);
+        }
+    }
+
+    void load_value(uint8_t x86, const Operand &operand) {
+        if (operand.kind == OperandKind::REG) {
+            as.load(x86, operand.reg);
+        } else {
+            as.emit({uint8_t(0xB8 + x86)});
+            as.imm32(operand.value);
+        }
+    }
+
+    /// @brief Emits the address checks of a word access
+    /// @return displacement from r15 of a statically valid address, -1 when the offset is
+    /// computed into rax
+    int64_t data_offset(const Operand &operand, int line) {
+        if (operand.kind == OperandKind::ADDR) {
+            uint32_t address = uint32_t(operand.value);
+            if (address % 4 == 0 && address >= DATA_BASE && uint64_t(address) + 4 <= DATA_BASE + uint64_t(memory_size))
+                return address - DATA_BASE;
+            as.emit({0xB8});
+            as.imm32(operand.value);
+        } else {
+            as.load(EAX, operand.reg);
+            if (operand.value != 0) {
+                as.emit({0x05});                // add eax, imm32
+                as.imm32(operand.value);
+            }
+        }
+        as.emit({0xA8, 0x03});                  // test al, 3
+        as.jump(JNE, fault(Jit::UNALIGNED, line));
+        if (memory_size < 4) {
+            as.jump(0, fault(Jit::OUT_OF_SEGMENT, line));
+            return -1;
+        }
+        as.emit({0x2D});                        // sub eax, DATA_BASE
+        as.imm32(int32_t(DATA_BASE));
+        as.emit({0x3D});                        // cmp eax, size - 4
+        as.imm32(int32_t(memory_size - 4));
+        as.jump(JA, fault(Jit::OUT_OF_SEGMENT, line));
+        return -1;
+    }
+
+    /// @param opcode 8B to load ecx, 89 to store it
+    void access_memory(uint8_t opcode, const Operand &address, int line) {
+        int64_t offset = data_offset(address, line);
+        if (offset >= 0) {
+            as.emit({0x41, opcode, 0x8F});      // ecx, [r15 + disp32]
+            as.imm32(int32_t(offset));
+        } else {
+            as.emit({0x41, opcode, 0x0C, 0x07}); // ecx, [r15 + rax]
+        }
+    }
+
+    void branch(uint8_t condition, const Instruction &instr) {
+        auto &ops = instr.operands;
+        as.load(EAX, reg(instr, 0));
+        if (ops.size() < 3)
+            fail(instr.line, "missing operand");
+        alu(0x3B, ops[1]);                      // cmp eax, operand
+        as.jump(condition, target(ops[2]));
+    }
+
+    void compare_zero(int reg) {
+        as.emit({0x83});                        // cmp dword [reg], 0
+        as.reg_operand(7, reg);
+        as.emit({0x00});
+    }
+
+    void compare_floats(uint8_t setcc, int lhs, int rhs) {
+        as.sse(0x10, 0, lhs);                   // movss xmm0, [lhs]
+        as.emit({0x0F, 0x2E});                  // ucomiss xmm0, [rhs]
+        as.reg_operand(0, rhs);
+        as.emit({0x0F, setcc, 0xC0});           // setcc al
+    }
+
+    static int reg(const Instruction &instr, std::size_t i) {
+        if (instr.operands.size() <= i || instr.operands[i].kind != OperandKind::REG)
+            fail(instr.line, "register operand expected");
+        return instr.operands[i].reg;
+    }
+
+    void translate(const Instruction &instr) {
+        auto &ops = instr.operands;
+        auto operand = [&](std::size_t i) {
+            if (ops.size() <= i)
+                fail(instr.line, "missing operand");
+            return ops[i];
+        };
+        auto arithmetic = [&](uint8_t op, const Operand &rhs) {
+            as.load(EAX, reg(instr, 1));
+            alu(op, rhs);
+            as.jump(JO, fault(Jit::OVERFLOW, instr.line));
+            as.store(reg(instr, 0), EAX);
+        };
+        auto float_arithmetic = [&](uint8_t op) {
+            as.sse(0x10, 0, reg(instr, 1));     // movss xmm0, [rs]
+            as.sse(op, 0, reg(instr, 2));
+            if (reg(instr, 0) != 0)
+                as.sse(0x11, 0, reg(instr, 0)); // movss [rd], xmm0
+        };
+        auto copy = [&](int to, int from) {
+            as.load(EAX, from);
+            as.store(to, EAX);
+        };
+
+        switch (instr.opcode) {
+            case LI: as.store_imm(reg(instr, 0), operand(1).value); break;
+            case LA:
+                if (operand(1).kind == OperandKind::MEM) {
+                    as.load(EAX, ops[1].reg);
+                    as.emit({0x05});            // add eax, imm32
+                    as.imm32(ops[1].value);
+                    as.store(reg(instr, 0), EAX);
+                } else {
+                    as.store_imm(reg(instr, 0), ops[1].value);
+                }
+                break;
+            case MOVE: case MOV_S: case MFC1: copy(reg(instr, 0), reg(instr, 1)); break;
+            case MTC1: copy(reg(instr, 1), reg(instr, 0)); break;
+            case ADD: case ADDI: arithmetic(0x03, operand(2)); break;
+            case SUB: arithmetic(0x2B, operand(2)); break;
+            case SUBI: {
+                Operand imm = operand(2);
+                imm.kind = OperandKind::IMM;
+                arithmetic(0x2B, imm);
+                break;
+            }
+            case MUL:
+                as.load(EAX, reg(instr, 1));
+                if (operand(2).kind == OperandKind::REG) {
+                    as.emit({0x0F, 0xAF});      // imul eax, [rt]
+                    as.reg_operand(EAX, ops[2].reg);
+                } else {
+                    as.emit({0x69, 0xC0});      // imul eax, eax, imm32
+                    as.imm32(ops[2].value);
+                }
+                as.store(reg(instr, 0), EAX);
+                break;
+            case DIV:
+                as.load(EAX, reg(instr, 1));
+                load_value(ECX, operand(2));
+                as.emit({0x85, 0xC9});          // test ecx, ecx
+                as.jump(JE, fault(Jit::DIVISION_BY_ZERO, instr.line));
+                // idiv traps on INT32_MIN / -1, negation wraps like the simulator
+                as.emit({0x83, 0xF9, 0xFF});    // cmp ecx, -1
+                as.emit({0x75, 0x04, 0xF7, 0xD8, 0xEB, 0x03}); // jne idiv; neg eax; jmp done
+                as.emit({0x99, 0xF7, 0xF9});    // idiv: cdq; idiv ecx
+                as.store(reg(instr, 0), EAX);
+                break;
+            case SLL:
+                as.load(EAX, reg(instr, 1));
+                as.emit({0xC1, 0xE0, uint8_t(operand(2).value & 31)}); // shl eax, imm8
+                as.store(reg(instr, 0), EAX);
+                break;
+            case ADD_S: float_arithmetic(0x58); break;
+            case SUB_S: float_arithmetic(0x5C); break;
+            case MUL_S: float_arithmetic(0x59); break;
+            case DIV_S: float_arithmetic(0x5E); break;
+            case CVT_S_W:
+                as.sse(0x2A, 0, reg(instr, 1)); // cvtsi2ss xmm0, [rs]
+                if (reg(instr, 0) != 0)
+                    as.sse(0x11, 0, reg(instr, 0));
+                break;
+            case CVT_W_S:
+                as.load(EDI, reg(instr, 1));
+                as.call(reinterpret_cast<const void *>(&convert_to_word));
+                as.store(reg(instr, 0), EAX);
+                break;
+            case LW: case L_S:
+                access_memory(0x8B, operand(1), instr.line);
+                as.store(reg(instr, 0), ECX);
+                break;
+            case SW: case S_S:
+                as.load(ECX, reg(instr, 0));
+                access_memory(0x89, operand(1), instr.line);
+                break;
+            case C_EQ_S:
+                compare_floats(0x94, reg(instr, 0), reg(instr, 1)); // sete, unordered sets ZF and PF
+                as.emit({0x0F, 0x9B, 0xC1, 0x20, 0xC8});             // setnp cl; and al, cl
+                as.emit({0x0F, 0xB6, 0xC0});                         // movzx eax, al
+                as.store(FLAG, EAX);
+                break;
+            case C_LT_S: case C_LE_S:
+                // a < b is b > a, false when unordered
+                compare_floats(instr.opcode == C_LT_S ? 0x97 : 0x93, reg(instr, 1), reg(instr, 0));
+                as.emit({0x0F, 0xB6, 0xC0});
+                as.store(FLAG, EAX);
+                break;
+            case BC1T: case BC1F:
+                compare_zero(FLAG);
+                as.jump(instr.opcode == BC1T ? JNE : JE, target(operand(0)));
+                break;
+            case BEQ: branch(JE, instr); break;
+            case BNE: branch(JNE, instr); break;
+            case BLT: branch(JL, instr); break;
+            case BLE: branch(JLE, instr); break;
+            case BGT: branch(JG, instr); break;
+            case BGE: branch(JGE, instr); break;
+            case BGEU: branch(JAE, instr); break;
+            case BEQZ: case BNEZ: case BLTZ: case BLEZ: case BGTZ: case BGEZ: {
+                static const uint8_t conditions[] = {JE, JNE, JL, JLE, JG, JGE};
+                compare_zero(reg(instr, 0));
+                as.jump(conditions[instr.opcode - BEQZ], target(operand(1)));
+                break;
+            }
+            case B: case J: as.jump(0, target(operand(0))); break;
+            case SYSCALL:
+                as.emit({0x48, 0x89, 0xDF});    // mov rdi, rbx
+                as.call(reinterpret_cast<const void *>(&handle_syscall));
+                as.emit({0x85, 0xC0});          // test eax, eax
+                as.jump(JNE, fault(Jit::NONE, instr.line));
+                break;
+            case NOP: break;
+        }
+    }
+
+    const std::vector<Instruction> &text;
+    uint32_t memory_size;
+    Assembler as;
+    std::vector<Stub> stubs;
+    int epilogue = 0;
+};
+
+const char *fault_message(Jit::Fault fault) {
+    switch (fault) {
+        case Jit::OVERFLOW: return "arithmetic overflow";
+        case Jit::DIVISION_BY_ZERO: return "division by zero";
+        case Jit::UNALIGNED: return "unaligned memory access";
+        case Jit::OUT_OF_SEGMENT: return "memory access out of the data segment";
+        case Jit::STRING_OUT_OF_SEGMENT: return "string out of the data segment";
+        case Jit::OUTPUT_ERROR: return "output error";
+        default: return "";
+    }
+}
+
+}
+
+Jit::~Jit() {
+#ifdef JIT_SUPPORTED
+    if (code != nullptr)
+        munmap(code, code_size);
+#endif
+}
+
+void Jit::load(std::istream &source) {
+#ifdef JIT_SUPPORTED
+    Listing listing;
+    listing.load(source);
+    if (listing.memory.size() > UINT32_MAX - DATA_BASE)
+        throw std::runtime_error("data segment too large");
+    auto bytes = Translator(listing.text, uint32_t(listing.memory.size())).translate();
+    data = std::move(listing.memory);
+
+    if (code != nullptr)
+        munmap(code, code_size);
+    code_size = bytes.size();
+    code = mmap(nullptr, code_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        code = nullptr;
+        throw std::runtime_error("cannot allocate memory for the generated code");
+    }
+    std::memcpy(code, bytes.data(), code_size);
+    if (mprotect(code, code_size, PROT_READ | PROT_EXEC) != 0)
+        throw std::runtime_error("cannot make the generated code executable");
+#else
+    (void) source;
+    throw std::runtime_error("--run needs an x86-64 Linux host");
+#endif
+}
+
+void Jit::run(std::ostream &out) {
+    if (code == nullptr)
+        throw std::runtime_error("no program loaded");
+    std::vector<uint8_t> memory = data;
+    State state{};
+    state.memory = memory.data();
+    state.memory_size = uint32_t(memory.size());
+    state.out = &out;
+
+    auto entry = reinterpret_cast<void (*)(State *, uint8_t *)>(code);
+    entry(&state, memory.data());
+    if (state.fault == UNSUPPORTED_SYSCALL)
+        fail(state.fault_line, "unsupported syscall " + std::to_string(state.regs[2]));
+    if (state.fault != NONE)
+        fail(state.fault_line, fault_message(Fault(state.fault)));
+}
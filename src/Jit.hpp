@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "MipsListing.hpp"
+
+/// @brief Translates the MIPS subset emitted by Compiler to x86-64 machine code and runs it in
+/// process. Behaves like MipsSim::run, including its runtime errors, without the statistics and
+/// the step limit. Only available on x86-64 Linux.
+class Jit {
+public:
+    Jit() = default;
+
+    Jit(const Jit &) = delete;
+
+    Jit &operator=(const Jit &) = delete;
+
+    ~Jit();
+
+    /// @brief Parses the .data:/.text: listing produced by the compiler and translates it
+    /// @throws std::runtime_error on unsupported syntax or when the host is not x86-64 Linux
+    void load(std::istream &source);
+
+    /// @brief Executes the translated program from its first instruction with fresh registers
+    /// and data segment, syscalls print to out
+    /// @throws std::runtime_error on runtime faults
+    void run(std::ostream &out);
+
+    /// @brief Per run state the generated code works on, its register file stays in memory
+    struct State {
+        int32_t regs[mips::REGISTER_COUNT]; // GPRs, FPRs as raw bits, condition flag
+        int32_t fault;                      // Fault, set before leaving the code early
+        int32_t fault_line;
+        uint8_t *memory;                    // data segment, addressed relative to DATA_BASE
+        uint32_t memory_size;
+        std::ostream *out;
+    };
+
+    enum Fault : int32_t {
+        NONE, OVERFLOW, DIVISION_BY_ZERO, UNALIGNED, OUT_OF_SEGMENT, STRING_OUT_OF_SEGMENT, UNSUPPORTED_SYSCALL,
+        OUTPUT_ERROR,
+    };
+
+private:
+    std::vector<uint8_t> data;
+    void *code = nullptr;
+    std::size_t code_size = 0;
+};
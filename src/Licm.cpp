@@ -0,0 +1,188 @@
+#include "Licm.hpp"
+#include "LoopInfo.hpp"
+
+#include <set>
+
+namespace passes {
+
+namespace {
+
+std::string base_symbol(const std::string &symbol) {
+    return symbol.substr(0, symbol.find('+'));
+}
+
+/// @brief What the loop writes, collected once per loop
+struct LoopEffects {
+    ir::RegSet defs;
+    std::set<std::string> stored_symbols; // base names of symbols written by name
+    bool indirect_store = false;
+    std::vector<int> exiting_blocks;
+};
+
+LoopEffects collect_effects(const ir::Program &program, const ir::Loop &loop) {
+    LoopEffects effects;
+    for (int b: loop.blocks) {
+        for (auto &instr: program.blocks[b].instrs) {
+            effects.defs |= ir::reg_set(instr.defs());
+            if (instr.is_store()) {
+                if (instr.operands[1].is_mem())
+                    effects.indirect_store = true;
+                else
+                    effects.stored_symbols.insert(base_symbol(instr.operands[1].text));
+            }
+        }
+        // a failed bounds check leaves the loop as well, through the handler
+        auto &instrs = program.blocks[b].instrs;
+        bool exits = !instrs.empty() && instrs.back().is_branch() && instrs.back().target() == ir::BOUNDS_FAIL_LABEL;
+        for (int succ: program.successors(b))
+            exits |= !loop.contains(succ);
+        if (exits)
+            effects.exiting_blocks.push_back(b);
+    }
+    return effects;
+}
+
+/// @brief Symbols used as array bases, the only ones an indirect store can write
+std::set<std::string> array_base_symbols(const ir::Program &program) {
+    std::set<std::string> symbols;
+    for (auto &bb: program.blocks) {
+        for (auto &instr: bb.instrs) {
+            if (instr.opcode == "la")
+                symbols.insert(base_symbol(instr.operands[1].text));
+        }
+    }
+    return symbols;
+}
+
+bool is_invariant(const ir::Instr &instr, const LoopEffects &effects,
+                  const std::set<std::string> &address_taken) {
+    // instructions that may trap are invariant too, the caller hoists them only out of blocks
+    // running on every iteration
+    auto kind = instr.info().kind;
+    if (kind != ir::OpInfo::Kind::ARITHMETIC && kind != ir::OpInfo::Kind::LOAD)
+        return false;
+    // cheap enough to stay, moving them only costs a register
+    if (instr.opcode == "li" || ir::is_copy(instr.opcode))
+        return false;
+    if (instr.defs().size() != 1)
+        return false;
+    if ((ir::reg_set(instr.uses()) & effects.defs).any())
+        return false;
+
+    if (instr.is_load()) {
+        auto &address = instr.operands[1];
+        if (address.is_mem()) {
+            if (effects.indirect_store)
+                return false;
+            for (auto &symbol: effects.stored_symbols) {
+                if (address_taken.count(symbol))
+                    return false;
+            }
+        } else {
+            auto symbol = base_symbol(address.text);
+            if (effects.stored_symbols.count(symbol) || (effects.indirect_store && address_taken.count(symbol)))
+                return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Reads of reg after position from in the block read replacement instead, up to the next write of reg
+void forward_copy(std::vector<ir::Instr> &instrs, std::size_t from, const std::string &reg,
+                  const std::string &replacement) {
+    for (std::size_t i = from; i < instrs.size(); i++) {
+        auto &instr = instrs[i];
+        int def_operand = instr.info().def_operand;
+        for (int k = 0; k < int(instr.operands.size()); k++) {
+            auto &op = instr.operands[k];
+            if (op.text == reg && (op.is_mem() || (op.is_reg() && k != def_operand)))
+                op.text = replacement;
+        }
+        for (auto &def: instr.defs()) {
+            if (def == reg)
+                return;
+        }
+    }
+}
+
+/// @brief Hoists the first invariant instruction of the loop
+/// @return true if the program changed
+bool hoist_one(ir::Program &program, const ir::LoopInfo &loop_info, const ir::Loop &loop,
+               const ir::Liveness &liveness, const std::set<std::string> &address_taken, PassStats &stats) {
+    auto effects = collect_effects(program, loop);
+    auto &preheader = program.blocks[loop.preheader].instrs;
+    const ir::Instr *terminator = !preheader.empty() && preheader.back().is_terminator() ? &preheader.back() : nullptr;
+    auto insert_pos = preheader.end() - (terminator != nullptr ? 1 : 0);
+    auto &live_on_entry = liveness.live_in(loop.header);
+
+    for (int b: loop.blocks) {
+        bool runs_every_iteration = true;
+        for (int exiting: effects.exiting_blocks)
+            runs_every_iteration &= loop_info.dominates(b, exiting);
+
+        auto &instrs = program.blocks[b].instrs;
+        for (std::size_t i = 0; i < instrs.size(); i++) {
+            auto &instr = instrs[i];
+            if (!is_invariant(instr, effects, address_taken) || (instr.may_trap() && !runs_every_iteration))
+                continue;
+
+            std::string def = instr.defs()[0];
+            int def_bit = ir::reg_bit(def);
+            if (def_bit < 0)
+                continue;
+
+            // single definition of a register dead on entry, the instruction can move as it is
+            int def_count = 0;
+            for (int lb: loop.blocks) {
+                for (auto &other: program.blocks[lb].instrs)
+                    def_count += ir::reg_set(other.defs()).test(def_bit);
+            }
+            bool terminator_reads = terminator != nullptr && ir::reg_set(terminator->uses()).test(def_bit);
+            if (def_count == 1 && !live_on_entry.test(def_bit) && !terminator_reads) {
+                preheader.insert(insert_pos, instr);
+                instrs.erase(instrs.begin() + long(i));
+                stats.add("hoisted", 1);
+                return true;
+            }
+
+            // otherwise compute into a fresh register and leave a copy in the loop
+            auto fresh = ir::find_unused_register(program, loop, live_on_entry, def);
+            if (fresh.empty()) {
+                stats.add("out of registers", 1);
+                continue;
+            }
+            ir::Instr hoisted = instr;
+            hoisted.operands[hoisted.info().def_operand] = ir::Operand(fresh);
+            instr = ir::Instr(def[1] == 'f' ? "mov.s" : "move", {def, fresh});
+            forward_copy(instrs, i + 1, def, fresh);
+            preheader.insert(insert_pos, std::move(hoisted));
+            stats.add("hoisted", 1);
+            stats.add("renamed", 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+void licm(ir::Program &program, PassStats &stats) {
+    auto address_taken = array_base_symbols(program);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        ir::LoopInfo loop_info(program);
+        ir::Liveness liveness(program);
+        for (auto &loop: loop_info.loops()) {
+            if (loop.preheader < 0)
+                continue;
+            if (hoist_one(program, loop_info, loop, liveness, address_taken, stats)) {
+                changed = true;
+                break;
+            }
+        }
+    }
+}
+
+}
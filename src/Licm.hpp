@@ -0,0 +1,11 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Loop-invariant code motion: moves address arithmetic, literal and bound loads
+/// whose operands do not change inside a loop to the loop preheader, innermost loops first.
+void licm(ir::Program &program, PassStats &stats);
+
+}
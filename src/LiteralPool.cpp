@@ -0,0 +1,125 @@
+#include "LiteralPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+LiteralPool::LiteralPool(HashMap<Symbol, SymbolInfo> &symbolTable, Interner &interner)
+    : symbolTable(symbolTable), interner(interner) {}
+
+Symbol LiteralPool::string_symbol(Symbol text) {
+    if (auto found = string_symbols.find(text)) {
+        strings.at(*found.value()).uses++;
+        return *found.value();
+    }
+    Symbol symbol = interner.intern("__str" + std::to_string(counter++));
+    symbolTable[symbol] = {VarType::U8_ARR, false, text};
+    string_symbols[text] = symbol;
+    strings[symbol] = {text, 1};
+    return symbol;
+}
+
+Symbol LiteralPool::float_symbol(float value, Symbol text) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if (auto found = float_symbols.find(bits))
+        return *found.value();
+    Symbol symbol = interner.intern("__float" + std::to_string(counter++));
+    symbolTable[symbol] = {VarType::F32, false, text};
+    float_symbols[bits] = symbol;
+    return symbol;
+}
+
+Symbol LiteralPool::string_text(Symbol symbol) const {
+    return strings.at(symbol).text;
+}
+
+void LiteralPool::release_string(Symbol symbol) {
+    auto &pooled = strings.at(symbol);
+    if (--pooled.uses > 0)
+        return;
+    string_symbols.erase(pooled.text);
+    strings.erase(symbol);
+    symbolTable.erase(symbol);
+}
+
+namespace {
+
+/// @brief Characters of a literal, an escape sequence is one unit
+std::vector<std::string_view> string_units(std::string_view text) {
+    std::vector<std::string_view> units;
+    for (std::size_t i = 0; i < text.size(); i++) {
+        std::size_t length = text[i] == '\\' && i + 1 < text.size() ? 2 : 1;
+        units.push_back(text.substr(i, length));
+        i += length - 1;
+    }
+    return units;
+}
+
+}
+
+void write_string_literals(std::ostream &ostream, const std::vector<std::pair<Symbol, Symbol>> &literals) {
+    struct Literal {
+        Symbol symbol;
+        std::vector<std::string_view> units;
+        int host = -1; // literal whose storage ends with this one
+    };
+    std::vector<Literal> items;
+    for (auto &[symbol, text]: literals)
+        items.push_back({symbol, string_units(text.str())});
+
+    // In order of reversed content a suffix comes right before the strings ending with it
+    std::vector<int> order(items.size());
+    for (int i = 0; i < int(order.size()); i++)
+        order[i] = i;
+    auto reversed_less = [&](int a, int b) {
+        auto &ua = items[a].units, &ub = items[b].units;
+        return std::lexicographical_compare(ua.rbegin(), ua.rend(), ub.rbegin(), ub.rend());
+    };
+    std::stable_sort(order.begin(), order.end(), reversed_less);
+    for (int k = int(order.size()) - 2; k >= 0; k--) {
+        auto &shorter = items[order[k]].units, &longer = items[order[k + 1]].units;
+        if (shorter.size() < longer.size() && std::equal(shorter.rbegin(), shorter.rend(), longer.rbegin())) {
+            int next = order[k + 1];
+            items[order[k]].host = items[next].host >= 0 ? items[next].host : next;
+        }
+    }
+
+    std::vector<std::vector<int>> suffixes(items.size());
+    for (int i = 0; i < int(items.size()); i++) {
+        if (items[i].host >= 0)
+            suffixes[items[i].host].push_back(i);
+    }
+
+    for (int i = 0; i < int(items.size()); i++) {
+        if (items[i].host >= 0)
+            continue;
+        auto &units = items[i].units;
+        // longest suffix first, i.e. in order of the label position
+        auto &members = suffixes[i];
+        std::sort(members.begin(), members.end(), [&](int a, int b) {
+            return items[a].units.size() > items[b].units.size();
+        });
+
+        std::size_t begin = 0;
+        Symbol label = items[i].symbol;
+        for (int member: members) {
+            std::size_t end = units.size() - items[member].units.size();
+            if (end == begin) {
+                // same position, only possible for duplicates which the pool does not create
+                ostream << label << ":" << std::endl;
+            } else {
+                ostream << label << ":    .ascii    \"";
+                for (std::size_t u = begin; u < end; u++)
+                    ostream << units[u];
+                ostream << "\"" << std::endl;
+            }
+            begin = end;
+            label = items[member].symbol;
+        }
+        ostream << label << ":    .asciiz    \"";
+        for (std::size_t u = begin; u < units.size(); u++)
+            ostream << units[u];
+        ostream << "\"" << std::endl;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "HashMap.hpp"
+
+/// @brief Content addressed pool of the string and f32 literals placed in the data region,
+/// every distinct string and f32 bit pattern gets one __strN/__floatN symbol for all its uses
+class LiteralPool {
+public:
+    LiteralPool(HashMap<Symbol, SymbolInfo> &symbolTable, Interner &interner);
+
+    /// @param text literal as written in the source, without the quotes
+    /// @return data symbol holding the string
+    Symbol string_symbol(Symbol text);
+
+    /// @return data symbol holding the value
+    Symbol float_symbol(float value, Symbol text);
+
+    /// @return text of the string held by the data symbol
+    Symbol string_text(Symbol symbol) const;
+
+    /// @brief Gives up one use of the string, e.g. when it only initializes a u8 array.
+    /// The symbol leaves the pool and the symbol table with its last use.
+    void release_string(Symbol symbol);
+
+private:
+    struct PooledString {
+        Symbol text;
+        int uses = 0;
+    };
+
+    HashMap<Symbol, SymbolInfo> &symbolTable;
+    Interner &interner;
+    HashMap<Symbol, Symbol> string_symbols; // literal text -> data symbol
+    HashMap<Symbol, PooledString> strings; // data symbol -> text
+    HashMap<uint32_t, Symbol> float_symbols; // f32 bit pattern -> data symbol
+    int counter = 0;
+};
+
+/// @brief Writes .asciiz entries of the string literals given as (symbol, text) pairs.
+/// A literal which is a suffix of another one gets its label inside the longer string instead
+/// of a copy, the longer string is then split into .ascii pieces at those labels.
+void write_string_literals(std::ostream &ostream, const std::vector<std::pair<Symbol, Symbol>> &literals);
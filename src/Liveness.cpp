@@ -0,0 +1,83 @@
+#include "Liveness.hpp"
+
+#include <string>
+
+namespace ir {
+
+int reg_bit(std::string_view reg_name) {
+    if (reg_name == FLAG_REG)
+        return 63;
+    if (reg_name.size() < 3 || reg_name[0] != '$')
+        return -1;
+
+    int idx = 0;
+    for (std::size_t i = 2; i < reg_name.size(); i++) {
+        if (reg_name[i] < '0' || reg_name[i] > '9')
+            return -1;
+        idx = idx * 10 + (reg_name[i] - '0');
+    }
+
+    switch (reg_name[1]) {
+        case 't': return idx < 10 ? idx : -1;
+        case 'f': return idx < 32 ? 10 + idx : -1;
+        case 'v': return idx < 2 ? 42 + idx : -1;
+        case 'a': return idx < 4 ? 44 + idx : -1;
+        case 's': return idx < 8 ? 48 + idx : -1;
+        default: return -1;
+    }
+}
+
+RegSet reg_set(const std::vector<std::string> &regs) {
+    RegSet set;
+    for (auto &reg: regs) {
+        int bit = reg_bit(reg);
+        if (bit >= 0)
+            set.set(bit);
+    }
+    return set;
+}
+
+Liveness::Liveness(const Program &program)
+    : live_in_sets(program.blocks.size()), live_out_sets(program.blocks.size()) {
+    std::size_t block_count = program.blocks.size();
+    std::vector<RegSet> gen(block_count), kill(block_count);
+    std::vector<std::vector<int>> succs(block_count);
+
+    for (std::size_t b = 0; b < block_count; b++) {
+        for (auto &instr: program.blocks[b].instrs) {
+            gen[b] |= reg_set(instr.uses()) & ~kill[b];
+            kill[b] |= reg_set(instr.defs());
+        }
+        succs[b] = program.successors(int(b));
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (std::size_t b = block_count; b-- > 0;) {
+            RegSet out;
+            for (int succ: succs[b])
+                out |= live_in_sets[succ];
+            RegSet in = gen[b] | (out & ~kill[b]);
+            if (in != live_in_sets[b] || out != live_out_sets[b]) {
+                live_in_sets[b] = in;
+                live_out_sets[b] = out;
+                changed = true;
+            }
+        }
+    }
+}
+
+std::vector<RegSet> Liveness::live_after(const Program &program, int block) const {
+    auto &instrs = program.blocks[block].instrs;
+    std::vector<RegSet> result(instrs.size());
+    RegSet live = live_out_sets[block];
+    for (std::size_t i = instrs.size(); i-- > 0;) {
+        result[i] = live;
+        live &= ~reg_set(instrs[i].defs());
+        live |= reg_set(instrs[i].uses());
+    }
+    return result;
+}
+
+}
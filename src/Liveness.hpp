@@ -0,0 +1,34 @@
+#pragma once
+#include <bitset>
+#include <string_view>
+#include <vector>
+
+#include "Ir.hpp"
+
+namespace ir {
+
+using RegSet = std::bitset<64>;
+
+/// @return bit index of the register in RegSet or -1 for registers not tracked
+int reg_bit(std::string_view reg_name);
+
+RegSet reg_set(const std::vector<std::string> &regs);
+
+/// @brief Backward dataflow analysis of register liveness on block level
+class Liveness {
+public:
+    explicit Liveness(const Program &program);
+
+    const RegSet &live_in(int block) const { return live_in_sets[block]; }
+
+    const RegSet &live_out(int block) const { return live_out_sets[block]; }
+
+    /// @return for every instruction of the block, registers live right after it
+    std::vector<RegSet> live_after(const Program &program, int block) const;
+
+private:
+    std::vector<RegSet> live_in_sets;
+    std::vector<RegSet> live_out_sets;
+};
+
+}
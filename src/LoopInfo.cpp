@@ -0,0 +1,314 @@
+#include "LoopInfo.hpp"
+
+#include <algorithm>
+#include <climits>
+
+namespace ir {
+
+namespace {
+
+bool fits_i32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+/// @return index of the last instruction before end defining reg, -1 if none
+int last_def(const std::vector<Instr> &instrs, std::size_t end, const std::string &reg) {
+    for (std::size_t i = end; i-- > 0;) {
+        for (auto &def: instrs[i].defs()) {
+            if (def == reg)
+                return int(i);
+        }
+    }
+    return -1;
+}
+
+/// @return number of times the body runs. It runs once before the first test, then the loop is
+/// left at the first counter value start + k * step (k >= 1) passing the exit test.
+std::optional<int64_t> trip_count(const std::string &branch, int64_t start, int64_t step, int64_t bound) {
+    int64_t distance;
+    if (step > 0 && (branch == "bge" || branch == "bgt"))
+        distance = (branch == "bge" ? bound : bound + 1) - start;
+    else if (step < 0 && (branch == "ble" || branch == "blt"))
+        distance = start - (branch == "ble" ? bound : bound - 1);
+    else
+        return std::nullopt;
+
+    int64_t magnitude = step > 0 ? step : -step;
+    int64_t count = distance <= magnitude ? 1 : (distance + magnitude - 1) / magnitude;
+    // addi traps on overflow, every value the counter takes has to fit
+    if (!fits_i32(start + count * step))
+        return std::nullopt;
+    return count;
+}
+
+}
+
+bool Loop::contains(int block) const {
+    return std::binary_search(blocks.begin(), blocks.end(), block);
+}
+
+std::string find_unused_register(const Program &program, const Loop &loop,
+                                 const RegSet &live_on_entry, const std::string &like_reg) {
+    RegSet taken = live_on_entry;
+    for (int b: loop.blocks) {
+        for (auto &instr: program.blocks[b].instrs)
+            taken |= reg_set(instr.defs()) | reg_set(instr.uses());
+    }
+    auto &preheader = program.blocks[loop.preheader].instrs;
+    if (!preheader.empty() && preheader.back().is_terminator())
+        taken |= reg_set(preheader.back().uses());
+
+    std::vector<std::string> candidates;
+    if (like_reg[1] == 'f') {
+        for (int i = 31; i >= 0; i--)
+            candidates.push_back("$f" + std::to_string(i));
+    } else {
+        // saved registers are never handed out by the register manager
+        for (int i = 0; i < 8; i++)
+            candidates.push_back("$s" + std::to_string(i));
+        for (int i = 9; i >= 0; i--)
+            candidates.push_back("$t" + std::to_string(i));
+    }
+    for (auto &candidate: candidates) {
+        if (!taken.test(reg_bit(candidate)))
+            return candidate;
+    }
+    return {};
+}
+
+LoopInfo::LoopInfo(const Program &program) {
+    int block_count = int(program.blocks.size());
+    auto preds = program.predecessors();
+
+    // reverse post order for the iterative dominator algorithm
+    std::vector<int> order;
+    std::vector<int> rpo_index(block_count, -1);
+    {
+        std::vector<bool> visited(block_count, false);
+        std::vector<std::pair<int, std::size_t>> dfs = {{0, 0}};
+        visited[0] = true;
+        while (!dfs.empty()) {
+            auto &[block, next_succ] = dfs.back();
+            auto succs = program.successors(block);
+            if (next_succ < succs.size()) {
+                int succ = succs[next_succ++];
+                if (!visited[succ]) {
+                    visited[succ] = true;
+                    dfs.emplace_back(succ, 0);
+                }
+            } else {
+                order.push_back(block);
+                dfs.pop_back();
+            }
+        }
+        std::reverse(order.begin(), order.end());
+        for (int i = 0; i < int(order.size()); i++)
+            rpo_index[order[i]] = i;
+    }
+
+    idom.assign(block_count, -1);
+    idom[0] = 0;
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (rpo_index[a] > rpo_index[b])
+                a = idom[a];
+            while (rpo_index[b] > rpo_index[a])
+                b = idom[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int block: order) {
+            if (block == 0)
+                continue;
+            int new_idom = -1;
+            for (int pred: preds[block]) {
+                if (idom[pred] < 0)
+                    continue;
+                new_idom = new_idom < 0 ? pred : intersect(pred, new_idom);
+            }
+            if (new_idom != idom[block]) {
+                idom[block] = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    // natural loops, back edges to the same header are merged into one loop
+    for (int header: order) {
+        Loop loop{header};
+        for (int pred: preds[header]) {
+            if (idom[pred] >= 0 && dominates(header, pred))
+                loop.latches.push_back(pred);
+        }
+        if (loop.latches.empty())
+            continue;
+
+        std::vector<bool> in_loop(block_count, false);
+        in_loop[header] = true;
+        std::vector<int> worklist = loop.latches;
+        while (!worklist.empty()) {
+            int block = worklist.back();
+            worklist.pop_back();
+            if (in_loop[block])
+                continue;
+            in_loop[block] = true;
+            for (int pred: preds[block])
+                worklist.push_back(pred);
+        }
+
+        for (int b = 0; b < block_count; b++) {
+            if (!in_loop[b])
+                continue;
+            loop.blocks.push_back(b);
+            for (int succ: program.successors(b)) {
+                if (!in_loop[succ] && std::find(loop.exits.begin(), loop.exits.end(), succ) == loop.exits.end())
+                    loop.exits.push_back(succ);
+            }
+        }
+
+        std::vector<int> outside_preds;
+        for (int pred: preds[header]) {
+            if (!in_loop[pred])
+                outside_preds.push_back(pred);
+        }
+        if (outside_preds.size() == 1 && program.successors(outside_preds[0]).size() == 1)
+            loop.preheader = outside_preds[0];
+
+        loop_list.push_back(std::move(loop));
+    }
+
+    std::stable_sort(loop_list.begin(), loop_list.end(), [](const Loop &a, const Loop &b) {
+        return a.blocks.size() < b.blocks.size();
+    });
+}
+
+bool LoopInfo::dominates(int a, int b) const {
+    if (idom[b] < 0)
+        return false; // unreachable
+    while (true) {
+        if (a == b)
+            return true;
+        if (b == 0)
+            return false;
+        b = idom[b];
+    }
+}
+
+std::optional<CountedLoop> match_counted_loop(const Program &program, const Loop &loop,
+                                              const std::vector<std::string> &address_taken) {
+    if (loop.preheader < 0 || loop.latches.size() != 1)
+        return std::nullopt;
+    int step_block = loop.latches[0];
+    if (step_block + 1 != loop.header)
+        return std::nullopt;
+
+    // the body is the layout range after the step block
+    int last_body = loop.header;
+    while (last_body + 1 < int(program.blocks.size()) && loop.contains(last_body + 1))
+        last_body++;
+    if (int(loop.blocks.size()) != last_body - step_block + 1)
+        return std::nullopt;
+
+    auto &step_instrs = program.blocks[step_block].instrs;
+    auto &body_end = program.blocks[last_body].instrs;
+    auto &step_label = program.blocks[step_block].label;
+    if (step_instrs.empty() || body_end.empty() || step_label.empty())
+        return std::nullopt;
+    if (!body_end.back().is_jump() || body_end.back().target() != step_label)
+        return std::nullopt;
+
+    // the body must only leave through the final jump
+    for (int b = loop.header; b <= last_body; b++) {
+        auto &instrs = program.blocks[b].instrs;
+        for (std::size_t i = 0; i < instrs.size(); i++) {
+            if (!instrs[i].is_terminator() || (b == last_body && i + 1 == instrs.size()))
+                continue;
+            if (instrs[i].target() == BOUNDS_FAIL_LABEL)
+                continue; // ends the program
+            int target = program.find_block(instrs[i].target());
+            if (target <= step_block || target > last_body)
+                return std::nullopt;
+        }
+    }
+
+    auto &test = step_instrs.back();
+    if (!test.is_branch() || test.operands.size() != 3 || !test.operands[0].is_reg() || !test.operands[1].is_imm())
+        return std::nullopt;
+    const std::string &counter = test.operands[0].text;
+    std::size_t test_idx = step_instrs.size() - 1;
+
+    int store = -1;
+    for (std::size_t i = 0; i < test_idx; i++) {
+        auto &instr = step_instrs[i];
+        if (instr.opcode == "sw" && instr.operands[0].text == counter && instr.operands[1].is_symbol())
+            store = int(i);
+    }
+    if (store < 0 || last_def(step_instrs, test_idx, counter) > store)
+        return std::nullopt;
+    std::string iv = step_instrs[store].operands[1].text;
+    for (auto &symbol: address_taken) {
+        if (symbol == iv)
+            return std::nullopt;
+    }
+
+    int increment = last_def(step_instrs, std::size_t(store), counter);
+    if (increment < 0)
+        return std::nullopt;
+    auto &add = step_instrs[increment];
+    if (ir::additive_sign(add.opcode) == 0 || !add.operands[1].is_reg() || !add.operands[2].is_imm())
+        return std::nullopt;
+    int load = last_def(step_instrs, std::size_t(increment), add.operands[1].text);
+    if (load < 0 || step_instrs[load].opcode != "lw" || step_instrs[load].operands[1].text != iv)
+        return std::nullopt;
+    int64_t step = std::stoll(add.operands[2].text) * ir::additive_sign(add.opcode);
+
+    // the step block writes the counter, nothing else in the loop may
+    int stores = 0;
+    for (int b: loop.blocks) {
+        for (auto &instr: program.blocks[b].instrs) {
+            if (instr.is_store() && instr.operands[1].is_symbol() && instr.operands[1].text == iv)
+                stores++;
+        }
+    }
+    if (stores != 1)
+        return std::nullopt;
+
+    // start value from the preheader
+    auto &preheader = program.blocks[loop.preheader].instrs;
+    if (preheader.empty() || !preheader.back().is_jump()
+        || program.find_block(preheader.back().target()) != loop.header)
+        return std::nullopt;
+    int init = -1;
+    for (std::size_t i = 0; i < preheader.size(); i++) {
+        if (preheader[i].is_store() && preheader[i].operands[1].is_symbol() && preheader[i].operands[1].text == iv)
+            init = int(i);
+    }
+    if (init < 0 || preheader[init].opcode != "sw")
+        return std::nullopt;
+    int start_def = last_def(preheader, std::size_t(init), preheader[init].operands[0].text);
+    if (start_def < 0 || preheader[start_def].opcode != "li" || !preheader[start_def].operands[1].is_imm())
+        return std::nullopt;
+    int64_t start = std::stoll(preheader[start_def].operands[1].text);
+
+    auto count = trip_count(test.opcode, start, step, std::stoll(test.operands[1].text));
+    if (!count)
+        return std::nullopt;
+    return CountedLoop{step_block, loop.header, last_body, iv, start, step, count.value(), test.target()};
+}
+
+std::vector<std::string> address_taken_symbols(const Program &program) {
+    std::vector<std::string> symbols;
+    for (auto &bb: program.blocks) {
+        for (auto &instr: bb.instrs) {
+            if (instr.opcode == "la")
+                symbols.push_back(instr.operands[1].text.substr(0, instr.operands[1].text.find('+')));
+        }
+    }
+    return symbols;
+}
+
+}
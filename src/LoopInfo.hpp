@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Ir.hpp"
+#include "Liveness.hpp"
+
+namespace ir {
+
+struct Loop {
+    int header;
+    std::vector<int> blocks{};  // sorted, includes the header
+    std::vector<int> latches{}; // blocks with a back edge to the header
+    std::vector<int> exits{};   // blocks outside the loop reached from inside
+    int preheader = -1;       // single outside predecessor whose only successor is the header
+
+    bool contains(int block) const;
+};
+
+/// @return register of the same class as like_reg that no instruction of the loop or the
+/// preheader terminator names and that is dead on loop entry, empty if there is none
+std::string find_unused_register(const Program &program, const Loop &loop,
+                                 const RegSet &live_on_entry, const std::string &like_reg);
+
+/// @brief Loop in the shape emitted by Compiler::gen_for_begin/gen_for_end:
+///     preheader:  li s, START; sw s, iv; ... b BODY
+///     STEP:       lw r, iv; addi r, r, STEP; sw r, iv; ... bge r, BOUND, EXIT
+///     BODY...:    ... b STEP
+/// The step block may contain other updates, e.g. pointers bumped by strength reduction.
+struct CountedLoop {
+    int step_block;
+    int first_body;
+    int last_body;
+    std::string iv;
+    int64_t start;
+    int64_t step;
+    int64_t trip_count; // executions of the body
+    std::string exit_label;
+};
+
+/// @return the counted loop shape of loop, if it has one
+/// @param address_taken symbols whose address is loaded, see address_taken_symbols()
+std::optional<CountedLoop> match_counted_loop(const Program &program, const Loop &loop,
+                                              const std::vector<std::string> &address_taken);
+
+/// @return symbols whose address is loaded with la, they may be written by indirect stores
+std::vector<std::string> address_taken_symbols(const Program &program);
+
+/// @brief Dominator tree and natural loops of a program, loops ordered innermost first
+class LoopInfo {
+public:
+    explicit LoopInfo(const Program &program);
+
+    bool dominates(int a, int b) const;
+
+    const std::vector<Loop> &loops() const { return loop_list; }
+
+private:
+    std::vector<int> idom;
+    std::vector<Loop> loop_list;
+};
+
+}
@@ -0,0 +1,189 @@
+#include "LoopUnroll.hpp"
+#include "LoopInfo.hpp"
+
+#include <map>
+#include <optional>
+#include <unordered_set>
+
+namespace passes {
+
+namespace {
+
+/// @brief Builds the unrolled code out of copies of the body and of the counter step
+class LoopCopier {
+public:
+    LoopCopier(const ir::Program &program, const ir::CountedLoop &loop) : program(program), loop(loop) {
+        auto &step_instrs = program.blocks[loop.step_block].instrs;
+        step.assign(step_instrs.begin(), step_instrs.end() - 1);
+        for (std::size_t i = 0; i < step.size(); i++) {
+            if (step[i].opcode == "lw" && step[i].operands[1].text == loop.iv)
+                counter_load = int(i);
+        }
+        for (int b = loop.first_body; b <= loop.last_body; b++) {
+            for (auto &instr: program.blocks[b].instrs) {
+                if (instr.is_terminator() && is_body_label(instr.target()))
+                    targeted.insert(instr.target());
+            }
+        }
+    }
+
+    /// @return instructions of one body and step, without the jump back and the exit test
+    std::size_t iteration_size() const {
+        std::size_t size = step.size();
+        for (int b = loop.first_body; b <= loop.last_body; b++)
+            size += program.blocks[b].instrs.size();
+        return size - 1;
+    }
+
+    /// @brief Appends copy number copy of the body, labels of copy 0 stay as they are
+    /// @param with_step the jump back is replaced by the counter step
+    /// @param counter value of the counter in this iteration when known at compile time
+    /// @param labeled_entry the first block keeps its label, see entry_label()
+    void append_body(std::vector<ir::BasicBlock> &out, int copy, bool with_step,
+                     std::optional<int64_t> counter = std::nullopt, bool labeled_entry = false) {
+        for (int b = loop.first_body; b <= loop.last_body; b++) {
+            ir::BasicBlock bb = program.blocks[b];
+            bb.label = copy_label(bb.label, copy);
+            for (auto &instr: bb.instrs) {
+                if (instr.is_terminator() && is_body_label(instr.target()))
+                    instr.operands.back() = ir::Operand(copy_label(instr.target(), copy));
+            }
+            // labels nothing jumps to would only split the copies into blocks the peephole
+            // optimizes separately
+            bool needed = copy == 0 || targeted.count(program.blocks[b].label) != 0 ||
+                          (b == loop.first_body && labeled_entry);
+            if (!needed && !out.empty() && (out.back().instrs.empty() || !out.back().instrs.back().is_terminator())) {
+                auto &instrs = out.back().instrs;
+                instrs.insert(instrs.end(), bb.instrs.begin(), bb.instrs.end());
+                continue;
+            }
+            out.push_back(std::move(bb));
+        }
+        if (!with_step)
+            return;
+
+        auto &last = out.back().instrs;
+        last.pop_back();
+        for (std::size_t i = 0; i < step.size(); i++) {
+            if (counter && int(i) == counter_load)
+                last.emplace_back("li", std::vector<ir::Operand>{step[i].operands[0], int(counter.value())});
+            else
+                last.push_back(step[i]);
+        }
+    }
+
+    /// @return label the first block of copy number copy has
+    std::string entry_label(int copy) {
+        return copy_label(program.blocks[loop.first_body].label, copy);
+    }
+
+private:
+    bool is_body_label(const std::string &label) const {
+        int block = program.find_block(label);
+        return block >= loop.first_body && block <= loop.last_body;
+    }
+
+    /// @return label the block with given label has in copy number copy, the same one on every
+    /// call. Loops unrolled before may already use the plain name, an inner loop copied into
+    /// the outer body has its copies labeled like the copies of the outer one.
+    std::string copy_label(const std::string &label, int copy) {
+        if (label.empty() || copy == 0)
+            return label;
+        auto [it, inserted] = copy_labels.try_emplace({label, copy});
+        if (inserted) {
+            std::string name = label + "_u" + std::to_string(copy);
+            for (int n = 2; program.find_block(name) >= 0 || !new_labels.insert(name).second; n++)
+                name = label + "_u" + std::to_string(copy) + "_" + std::to_string(n);
+            it->second = name;
+        }
+        return it->second;
+    }
+
+    const ir::Program &program;
+    const ir::CountedLoop &loop;
+    std::vector<ir::Instr> step;
+    std::unordered_set<std::string> targeted; // labels of body blocks branched to from the body
+    int counter_load = -1;
+    std::map<std::pair<std::string, int>, std::string> copy_labels; // (label, copy) -> label of the copy
+    std::unordered_set<std::string> new_labels;
+};
+
+/// @brief Replaces the blocks of the loop with given blocks, jumping to the exit unless it follows
+void replace_loop(ir::Program &program, const ir::CountedLoop &loop, std::vector<ir::BasicBlock> blocks) {
+    int next = loop.last_body + 1;
+    bool exit_follows = next < int(program.blocks.size()) && program.blocks[next].label == loop.exit_label;
+    if (!exit_follows && blocks.back().falls_through())
+        blocks.push_back({"", {ir::Instr("b", {loop.exit_label})}});
+    program.blocks.erase(program.blocks.begin() + loop.step_block, program.blocks.begin() + next);
+    program.blocks.insert(program.blocks.begin() + loop.step_block,
+                          std::make_move_iterator(blocks.begin()), std::make_move_iterator(blocks.end()));
+}
+
+/// @brief The body runs trip count times in a row, the counter values are literals
+void unroll_fully(ir::Program &program, const ir::CountedLoop &loop, LoopCopier &copier) {
+    std::vector<ir::BasicBlock> blocks;
+    for (int copy = 0; copy < loop.trip_count; copy++)
+        copier.append_body(blocks, copy, true, loop.start + copy * loop.step);
+    replace_loop(program, loop, std::move(blocks));
+}
+
+/// @brief factor bodies per counter test, then the trip_count % factor remaining ones
+void unroll_partially(ir::Program &program, const ir::CountedLoop &loop, LoopCopier &copier, int factor) {
+    int64_t remainder = loop.trip_count % factor;
+    int64_t unrolled = loop.trip_count - remainder;
+    std::string remainder_label = remainder == 0 ? loop.exit_label : copier.entry_label(factor);
+
+    std::vector<ir::BasicBlock> blocks;
+    ir::BasicBlock step_block = program.blocks[loop.step_block];
+    auto &test = step_block.instrs.back();
+    test = ir::Instr(loop.step > 0 ? "bge" : "ble",
+                     {test.operands[0], int(loop.start + unrolled * loop.step), remainder_label});
+    blocks.push_back(std::move(step_block));
+
+    for (int copy = 0; copy < factor; copy++)
+        copier.append_body(blocks, copy, copy + 1 < factor);
+    for (int copy = 0; copy < remainder; copy++)
+        copier.append_body(blocks, factor + copy, true, loop.start + (unrolled + copy) * loop.step, copy == 0);
+    replace_loop(program, loop, std::move(blocks));
+}
+
+/// @return true if a loop was unrolled
+bool unroll_one(ir::Program &program, PassStats &stats, int factor, int budget) {
+    ir::LoopInfo loop_info(program);
+    auto address_taken = ir::address_taken_symbols(program);
+    long over_budget = 0;
+    for (auto &info: loop_info.loops()) {
+        auto loop = ir::match_counted_loop(program, info, address_taken);
+        if (!loop)
+            continue;
+        LoopCopier copier(program, loop.value());
+        int64_t size = int64_t(copier.iteration_size());
+
+        if (loop->trip_count * size <= budget) {
+            unroll_fully(program, loop.value(), copier);
+            stats.add("loops fully unrolled", 1);
+            return true;
+        }
+        // at least two rounds, otherwise it is full unrolling with extra tests
+        int64_t remainder = loop->trip_count % factor;
+        if (factor >= 2 && loop->trip_count >= 2 * factor && (factor + remainder) * size + 1 <= budget) {
+            unroll_partially(program, loop.value(), copier, factor);
+            stats.add("loops partially unrolled", 1);
+            return true;
+        }
+        over_budget++;
+    }
+    if (over_budget > 0)
+        stats.add("over budget", over_budget);
+    return false;
+}
+
+}
+
+void unroll_loops(ir::Program &program, PassStats &stats, int factor, int budget) {
+    // an unrolled loop stores its counter more than once and does not match again
+    while (unroll_one(program, stats, factor, budget)) {
+    }
+}
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Unrolls for loops whose counter starts at a literal and is compared against a literal
+/// bound. Loops whose whole unrolled code fits in the size budget are replaced by straight-line
+/// code, longer ones run factor bodies per counter test followed by the remaining iterations.
+/// @param factor bodies per iteration of a partially unrolled loop, below 2 disables partial unrolling
+/// @param budget maximum number of instructions of an unrolled loop
+void unroll_loops(ir::Program &program, PassStats &stats, int factor, int budget);
+
+}
@@ -2,9 +2,10 @@
 
 #include <cassert>
 
-MainStack::MainStack(HashMap<std::string, SymbolInfo> &symbolTable): symbolTable(symbolTable) {}
+MainStack::MainStack(HashMap<Symbol, SymbolInfo> &symbolTable, Interner &interner, LiteralPool &literal_pool)
+    : symbolTable(symbolTable), interner(interner), literal_pool(literal_pool) {}
 
-void MainStack::push(ExprElemType type, const std::string &value, VarType var_type) {
+void MainStack::push(ExprElemType type, Symbol value, VarType var_type) {
     if (type == ExprElemType::STRING_LITERAL) {
         push_string_literal(value);
         return;
@@ -15,17 +16,12 @@ void MainStack::push(ExprElemType type, const std::string &value, VarType var_ty
         if (sym.has_value())
             var_type = sym.value()->type;
         else
-            throw std::runtime_error("Use of undeclared variable: " + value);
+            throw std::runtime_error("Use of undeclared variable: " + value.string());
     }
-    else if (type == ExprElemType::NUMBER && var_type == VarType::F32) {
-        push_float_literal(value);
-        return;
-    }
-
     stack.push({value, type, var_type});
 }
 
-void MainStack::push_id(const std::string &id, bool allow_undeclared) {
+void MainStack::push_id(Symbol id, bool allow_undeclared) {
     if (allow_undeclared) {
         stack.push({id, ExprElemType::ID});
         return;
@@ -60,16 +56,11 @@ std::pair<StackEntry, StackEntry> MainStack::pop_two() {
     return {lhs, rhs};
 }
 
-void MainStack::push_string_literal(const std::string& value) {
-    std::string symbol_name = "__str" + std::to_string(str_counter);
-    symbolTable[symbol_name] = {VarType::U8_ARR, false, value};
-    stack.push({symbol_name, ExprElemType::ID, VarType::U8_ARR});
-    str_counter++;
+void MainStack::push_string_literal(Symbol value) {
+    stack.push({literal_pool.string_symbol(value), ExprElemType::ID, VarType::U8_ARR});
 }
 
-void MainStack::push_float_literal(const std::string &value) {
-    std::string symbol_name = "__float" + std::to_string(str_counter);
-    symbolTable[symbol_name] = {VarType::F32, false, value};
-    stack.push({symbol_name, ExprElemType::ID, VarType::F32});
-    str_counter++;
+StackEntry MainStack::materialize_float_literal(const StackEntry &literal) {
+    assert(literal.is_literal_f32());
+    return {literal_pool.float_symbol(literal.literal_as_f32(), literal.value), ExprElemType::ID, VarType::F32};
 }
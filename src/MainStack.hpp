@@ -3,22 +3,23 @@
 #include <utility>
 #include "common.hpp"
 #include "HashMap.hpp"
+#include "LiteralPool.hpp"
 
 class MainStack {
 public:
-    explicit MainStack(HashMap<std::string, SymbolInfo> &symbolTable);
+    MainStack(HashMap<Symbol, SymbolInfo> &symbolTable, Interner &interner, LiteralPool &literal_pool);
 
-    void push(ExprElemType type, const std::string &value, VarType var_type = VarType::UNDEFINED);
+    void push(ExprElemType type, Symbol value, VarType var_type = VarType::UNDEFINED);
 
-    void push_id(const std::string &id, bool allow_undeclared=false);
+    void push_id(Symbol id, bool allow_undeclared=false);
 
     void push(const StackEntry &entry);
 
     void push(int32_t value) {
-        push(ExprElemType::NUMBER, std::to_string(value), VarType::I32);
+        push(ExprElemType::NUMBER, interner.intern(std::to_string(value)), VarType::I32);
     }
     void push(float value) {
-        push(ExprElemType::NUMBER, std::to_string(value), VarType::F32);
+        push(ExprElemType::NUMBER, interner.intern(format_f32(value)), VarType::F32);
     }
 
     StackEntry &top();
@@ -30,14 +31,16 @@ public:
     /// @return [lhs, rhs]
     std::pair<StackEntry, StackEntry> pop_two();
 
-private:
-    void push_string_literal(const std::string &value);
+    /// @brief Places f32 literal in the data region
+    /// @return entry referencing the pooled symbol
+    StackEntry materialize_float_literal(const StackEntry &literal);
 
-    void push_float_literal(const std::string &value);
+private:
+    void push_string_literal(Symbol value);
 
 private:
     std::stack<StackEntry> stack;
-    HashMap<std::string, SymbolInfo> &symbolTable;
-    int str_counter = 0;
-    int float_counter = 0;
+    HashMap<Symbol, SymbolInfo> &symbolTable;
+    Interner &interner;
+    LiteralPool &literal_pool;
 };
\ No newline at end of file
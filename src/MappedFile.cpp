@@ -0,0 +1,78 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/// @brief Closes the descriptor when leaving the constructor, the mapping does not need it
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd) : fd(fd) {}
+
+    FileDescriptor(const FileDescriptor &) = delete;
+
+    FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+    ~FileDescriptor() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    int get() const { return fd; }
+
+private:
+    int fd;
+};
+
+}
+
+MappedFile::MappedFile(const std::string &path) {
+    FileDescriptor file(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (file.get() < 0)
+        throw std::runtime_error("cannot open input file");
+    struct stat info{};
+    if (fstat(file.get(), &info) != 0)
+        throw std::runtime_error("cannot read input file");
+
+    if (!S_ISREG(info.st_mode)) {
+        char chunk[64 * 1024];
+        ssize_t count;
+        while ((count = read(file.get(), chunk, sizeof(chunk))) > 0)
+            buffer.insert(buffer.end(), chunk, chunk + count);
+        if (count < 0)
+            throw std::runtime_error("cannot read input file");
+        length = buffer.size();
+        buffer.resize(length + 2, '\0');
+        contents = buffer.data();
+        return;
+    }
+
+    // Zeroed pages reserved for the file and its two NUL bytes, the file is mapped over their
+    // beginning. The rest of its last page reads as zeros as well.
+    length = std::size_t(info.st_size);
+    std::size_t page = std::size_t(sysconf(_SC_PAGESIZE));
+    std::size_t reserved = (length + 2 + page - 1) / page * page;
+    void *base = mmap(nullptr, reserved, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        throw std::runtime_error("cannot map input file");
+    if (length > 0) {
+        if (mmap(base, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file.get(), 0) == MAP_FAILED) {
+            munmap(base, reserved);
+            throw std::runtime_error("cannot map input file");
+        }
+        // the scanner reads the source once from front to back
+        madvise(base, length, MADV_SEQUENTIAL);
+    }
+    contents = static_cast<char *>(base);
+    mapped_length = reserved;
+}
+
+MappedFile::~MappedFile() {
+    if (mapped_length != 0)
+        munmap(contents, mapped_length);
+}
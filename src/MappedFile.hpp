@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// @brief Contents of a file mapped into memory, followed by two NUL bytes so the scanner can
+/// work on it in place. The pages are mapped private and writable: bytes written to them, like
+/// the token ends flex marks while scanning, never reach the file. Files which can not be mapped,
+/// like pipes, are read into memory instead.
+class MappedFile {
+public:
+    /// @throws std::runtime_error when the file can not be opened or read
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    /// @return first byte of the contents, data()[size()] and data()[size() + 1] are NUL
+    char *data() { return contents; }
+
+    std::size_t size() const { return length; }
+
+private:
+    char *contents = nullptr;
+    std::size_t length = 0;
+    std::size_t mapped_length = 0; // 0 when the contents are in buffer
+    std::vector<char> buffer;
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+
+/// @brief Process wide heap usage counters, updated by the replaced global operator new
+namespace memstats {
+
+struct Counters {
+    uint64_t allocations = 0;
+    uint64_t allocated_bytes = 0;
+};
+
+Counters current();
+
+/// @return counters of the allocations made by the calling thread
+Counters thread_current();
+
+/// @return peak resident set size of the process in KiB, 0 if unknown
+long peak_rss_kib();
+
+}
@@ -0,0 +1,291 @@
+#include "MipsListing.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+namespace mips {
+
+namespace {
+
+const std::unordered_map<std::string, Op> &opcodes() {
+    static const std::unordered_map<std::string, Op> table = {
+        {"li", LI}, {"la", LA}, {"move", MOVE}, {"mov.s", MOV_S},
+        {"add", ADD}, {"addu", ADD}, {"sub", SUB}, {"subu", SUB}, {"mul", MUL}, {"div", DIV},
+        {"addi", ADDI}, {"addiu", ADDI}, {"subi", SUBI}, {"sll", SLL},
+        {"add.s", ADD_S}, {"sub.s", SUB_S}, {"mul.s", MUL_S}, {"div.s", DIV_S},
+        {"mtc1", MTC1}, {"mfc1", MFC1}, {"cvt.s.w", CVT_S_W}, {"cvt.w.s", CVT_W_S},
+        {"lw", LW}, {"sw", SW}, {"l.s", L_S}, {"s.s", S_S},
+        {"c.eq.s", C_EQ_S}, {"c.lt.s", C_LT_S}, {"c.le.s", C_LE_S},
+        {"bc1t", BC1T}, {"bc1f", BC1F},
+        {"beq", BEQ}, {"bne", BNE}, {"blt", BLT}, {"ble", BLE}, {"bgt", BGT}, {"bge", BGE}, {"bgeu", BGEU},
+        {"beqz", BEQZ}, {"bnez", BNEZ}, {"bltz", BLTZ}, {"blez", BLEZ}, {"bgtz", BGTZ}, {"bgez", BGEZ},
+        {"b", B}, {"j", J},
+        {"syscall", SYSCALL}, {"nop", NOP},
+    };
+    return table;
+}
+
+std::string trim(const std::string &s) {
+    std::size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos)
+        return "";
+    std::size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+}
+
+/// @brief Splits instruction operands on commas outside of string literals
+std::vector<std::string> split_operands(const std::string &s) {
+    std::vector<std::string> parts;
+    std::string cur;
+    bool in_string = false;
+    for (std::size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '"' && (i == 0 || s[i - 1] != '\\'))
+            in_string = !in_string;
+        if (c == ',' && !in_string) {
+            parts.push_back(trim(cur));
+            cur.clear();
+        } else {
+            cur += c;
+        }
+    }
+    if (!trim(cur).empty())
+        parts.push_back(trim(cur));
+    return parts;
+}
+
+std::string strip_comment(const std::string &line) {
+    bool in_string = false;
+    for (std::size_t i = 0; i < line.size(); i++) {
+        if (line[i] == '"' && (i == 0 || line[i - 1] != '\\'))
+            in_string = !in_string;
+        if (line[i] == '#' && !in_string)
+            return line.substr(0, i);
+    }
+    return line;
+}
+
+}
+
+int find_opcode(const std::string &name) {
+    auto it = opcodes().find(name);
+    return it == opcodes().end() ? -1 : it->second;
+}
+
+int register_index(const std::string &name) {
+    static const std::unordered_map<std::string, int> named = {
+        {"zero", 0}, {"at", 1}, {"gp", 28}, {"sp", 29}, {"fp", 30}, {"ra", 31},
+    };
+    auto it = named.find(name);
+    if (it != named.end())
+        return it->second;
+    if (name.size() < 2)
+        return -1;
+
+    int n = 0;
+    for (std::size_t i = 1; i < name.size(); i++) {
+        if (!std::isdigit(static_cast<unsigned char>(name[i])))
+            return -1;
+        n = n * 10 + (name[i] - '0');
+    }
+    switch (name[0]) {
+        case 'v': return n < 2 ? 2 + n : -1;
+        case 'a': return n < 4 ? 4 + n : -1;
+        case 't': return n < 8 ? 8 + n : (n < 10 ? 24 + n - 8 : -1);
+        case 's': return n < 8 ? 16 + n : -1;
+        case 'k': return n < 2 ? 26 + n : -1;
+        case 'f': return n < 32 ? FPR_BASE + n : -1;
+        default: return -1;
+    }
+}
+
+float as_float(int32_t bits) {
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+int32_t as_bits(float f) {
+    int32_t bits;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+[[noreturn]] void fail(int line, const std::string &msg) {
+    throw std::runtime_error("line " + std::to_string(line) + ": " + msg);
+}
+
+void Listing::load(std::istream &source) {
+    std::vector<std::pair<int, std::string>> text_lines;
+    enum class Section { NONE, DATA, TEXT } section = Section::NONE;
+
+    std::string raw;
+    int line_no = 0;
+    while (std::getline(source, raw)) {
+        line_no++;
+        std::string line = trim(strip_comment(raw));
+        if (line.empty())
+            continue;
+        if (line.rfind(".data", 0) == 0) {
+            section = Section::DATA;
+            continue;
+        }
+        if (line.rfind(".text", 0) == 0) {
+            section = Section::TEXT;
+            continue;
+        }
+        if (line.rfind(".globl", 0) == 0 || line.rfind(".align", 0) == 0)
+            continue;
+        if (section == Section::DATA)
+            parse_data_line(line, line_no);
+        else if (section == Section::TEXT)
+            text_lines.emplace_back(line_no, line);
+        else
+            fail(line_no, "statement outside of .data/.text section");
+    }
+
+    // labels first so forward branches resolve
+    int index = 0;
+    for (auto &[no, line]: text_lines) {
+        std::string rest = line;
+        auto colon = rest.find(':');
+        while (colon != std::string::npos && rest.find(' ') > colon) {
+            text_labels[rest.substr(0, colon)] = index;
+            rest = trim(rest.substr(colon + 1));
+            colon = rest.find(':');
+        }
+        if (!rest.empty())
+            index++;
+    }
+    for (auto &[no, line]: text_lines)
+        parse_text_line(line, no);
+}
+
+void Listing::parse_data_line(const std::string &line, int line_no) {
+    std::string rest = line;
+    auto colon = rest.find(':');
+    auto quote = rest.find('"');
+    if (colon != std::string::npos && (quote == std::string::npos || colon < quote)) {
+        std::string label = trim(rest.substr(0, colon));
+        rest = trim(rest.substr(colon + 1));
+        // labels of word sized data are aligned by the directive below
+        bool word = rest.rfind(".word", 0) == 0 || rest.rfind(".float", 0) == 0;
+        if (word)
+            memory.resize((memory.size() + 3) & ~std::size_t(3));
+        data_symbols[label] = DATA_BASE + uint32_t(memory.size());
+    }
+    if (rest.empty())
+        return;
+
+    auto space = rest.find_first_of(" \t");
+    std::string directive = rest.substr(0, space);
+    std::string args = space == std::string::npos ? "" : trim(rest.substr(space));
+
+    auto push_word = [&](int32_t value) {
+        memory.resize((memory.size() + 3) & ~std::size_t(3));
+        for (int i = 0; i < 4; i++)
+            memory.push_back(uint8_t(uint32_t(value) >> (8 * i)));
+    };
+
+    if (directive == ".word" || directive == ".float") {
+        bool is_float = directive == ".float";
+        for (auto &item: split_operands(args)) {
+            auto repeat = item.find(':');
+            std::string value_text = item.substr(0, repeat);
+            int count = repeat == std::string::npos ? 1 : std::stoi(item.substr(repeat + 1));
+            int32_t value = is_float ? as_bits(std::stof(value_text)) : int32_t(std::stol(value_text, nullptr, 0));
+            for (int i = 0; i < count; i++)
+                push_word(value);
+        }
+    } else if (directive == ".asciiz" || directive == ".ascii") {
+        if (args.size() < 2 || args.front() != '"' || args.back() != '"')
+            fail(line_no, "malformed string literal");
+        for (std::size_t i = 1; i + 1 < args.size(); i++) {
+            char c = args[i];
+            if (c == '\\' && i + 2 < args.size()) {
+                char e = args[++i];
+                c = e == 'n' ? '\n' : e == 't' ? '\t' : e == '0' ? '\0' : e;
+            }
+            memory.push_back(uint8_t(c));
+        }
+        if (directive == ".asciiz")
+            memory.push_back(0);
+    } else if (directive == ".space") {
+        memory.resize(memory.size() + std::stoul(args));
+    } else {
+        fail(line_no, "unsupported data directive " + directive);
+    }
+}
+
+Operand Listing::parse_operand(const std::string &text, int line_no) {
+    Operand op;
+    auto paren = text.find('(');
+    if (paren != std::string::npos) {
+        op.kind = OperandKind::MEM;
+        std::string reg = text.substr(paren + 1, text.find(')') - paren - 1);
+        if (reg.empty() || reg[0] != '$' || (op.reg = register_index(reg.substr(1))) < 0)
+            fail(line_no, "bad base register " + text);
+        std::string offset = trim(text.substr(0, paren));
+        op.value = offset.empty() ? 0 : std::stoi(offset);
+        return op;
+    }
+    if (text[0] == '$') {
+        op.kind = OperandKind::REG;
+        op.reg = register_index(text.substr(1));
+        if (op.reg < 0)
+            fail(line_no, "unknown register " + text);
+        return op;
+    }
+    if (std::isdigit(static_cast<unsigned char>(text[0])) || text[0] == '-') {
+        op.kind = OperandKind::IMM;
+        op.value = int32_t(std::stol(text, nullptr, 0));
+        return op;
+    }
+
+    std::string symbol = text;
+    int32_t offset = 0;
+    auto plus = text.find('+');
+    if (plus != std::string::npos) {
+        symbol = trim(text.substr(0, plus));
+        offset = std::stoi(text.substr(plus + 1));
+    }
+    op.kind = OperandKind::ADDR;
+    auto data = data_symbols.find(symbol);
+    if (data != data_symbols.end()) {
+        op.value = int32_t(data->second) + offset;
+        return op;
+    }
+    auto label = text_labels.find(symbol);
+    if (label != text_labels.end()) {
+        op.value = label->second;
+        return op;
+    }
+    fail(line_no, "undefined symbol " + symbol);
+}
+
+void Listing::parse_text_line(const std::string &line, int line_no) {
+    std::string rest = line;
+    auto colon = rest.find(':');
+    while (colon != std::string::npos && rest.find(' ') > colon) {
+        rest = trim(rest.substr(colon + 1));
+        colon = rest.find(':');
+    }
+    if (rest.empty())
+        return;
+
+    auto space = rest.find_first_of(" \t");
+    std::string name = rest.substr(0, space);
+    auto it = opcodes().find(name);
+    if (it == opcodes().end())
+        fail(line_no, "unsupported instruction " + name);
+
+    Instruction instr{it->second, {}, line_no};
+    if (space != std::string::npos) {
+        for (auto &part: split_operands(rest.substr(space)))
+            instr.operands.push_back(parse_operand(part, line_no));
+    }
+    text.push_back(std::move(instr));
+}
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief The MIPS subset emitted by Compiler, as read back by the simulator and the JIT
+namespace mips {
+
+enum Op {
+    LI, LA, MOVE, MOV_S,
+    ADD, SUB, MUL, DIV, ADDI, SUBI, SLL,
+    ADD_S, SUB_S, MUL_S, DIV_S,
+    MTC1, MFC1, CVT_S_W, CVT_W_S,
+    LW, SW, L_S, S_S,
+    C_EQ_S, C_LT_S, C_LE_S,
+    BC1T, BC1F,
+    BEQ, BNE, BLT, BLE, BGT, BGE, BGEU,
+    BEQZ, BNEZ, BLTZ, BLEZ, BGTZ, BGEZ,
+    B, J,
+    SYSCALL,
+    NOP,
+};
+
+constexpr int FPR_BASE = 32; // register file index of $f0
+constexpr int FLAG = 64;     // register file index of the FPU condition flag
+constexpr int REGISTER_COUNT = 65;
+
+constexpr uint32_t DATA_BASE = 0x10010000;
+
+enum class OperandKind { REG, IMM, ADDR, MEM };
+
+struct Operand {
+    OperandKind kind = OperandKind::IMM;
+    int reg = 0;          // REG, MEM base register
+    int32_t value = 0;    // IMM, ADDR absolute address or instruction index, MEM offset
+};
+
+struct Instruction {
+    int opcode;
+    std::vector<Operand> operands;
+    int line;
+};
+
+/// @brief Parsed .data:/.text: listing, symbols resolved to data addresses and instruction indices
+class Listing {
+public:
+    /// @brief Parses the listing produced by the compiler, the sections may alternate
+    /// @throws std::runtime_error on unsupported syntax
+    void load(std::istream &source);
+
+    /// @return address of every data label
+    const std::unordered_map<std::string, uint32_t> &data_labels() const { return data_symbols; }
+
+    std::vector<uint8_t> memory; // initial data segment, mapped at DATA_BASE
+    std::vector<Instruction> text;
+
+private:
+    void parse_data_line(const std::string &line, int line_no);
+
+    void parse_text_line(const std::string &line, int line_no);
+
+    Operand parse_operand(const std::string &text, int line_no);
+
+    std::unordered_map<std::string, uint32_t> data_symbols;
+    std::unordered_map<std::string, int> text_labels;
+};
+
+/// @return Op of an instruction name, -1 if it is not part of the subset
+int find_opcode(const std::string &name);
+
+/// @return register file index of a register name without the $, -1 if there is no such register
+int register_index(const std::string &name);
+
+float as_float(int32_t bits);
+
+int32_t as_bits(float f);
+
+/// @throws std::runtime_error with the listing line number in front of msg
+[[noreturn]] void fail(int line, const std::string &msg);
+
+}
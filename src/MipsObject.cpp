@@ -0,0 +1,522 @@
+#include "MipsObject.hpp"
+#include "MipsListing.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mips {
+
+namespace {
+
+constexpr int ZERO = 0;
+constexpr int AT = 1;
+
+enum RelocationType : uint8_t { R_MIPS_26 = 4, R_MIPS_HI16 = 5, R_MIPS_LO16 = 6 };
+
+// symbol table indices of the section symbols relocations refer to, with in-place addends
+constexpr uint32_t TEXT_SYMBOL = 1;
+constexpr uint32_t DATA_SYMBOL = 2;
+
+// section header indices
+enum Section : uint16_t { TEXT = 1, REL_TEXT, DATA, SYMTAB, STRTAB, SHSTRTAB, SECTION_COUNT };
+
+struct Relocation {
+    uint32_t offset;
+    uint32_t symbol;
+    uint8_t type;
+};
+
+/// @brief Section symbol and offset in that section of a symbol operand
+struct Address {
+    uint32_t symbol;
+    int32_t addend;
+};
+
+bool fits16(int64_t value) {
+    return value >= -32768 && value <= 32767;
+}
+
+uint32_t r_type(int rs, int rt, int rd, int shamt, int funct) {
+    return uint32_t(rs) << 21 | uint32_t(rt) << 16 | uint32_t(rd) << 11 | uint32_t(shamt) << 6 | uint32_t(funct);
+}
+
+uint32_t i_type(int opcode, int rs, int rt, int32_t imm) {
+    return uint32_t(opcode) << 26 | uint32_t(rs) << 21 | uint32_t(rt) << 16 | (uint32_t(imm) & 0xFFFF);
+}
+
+/// @brief COP1 instruction, fmt 0x10 single precision and 0x14 word
+uint32_t cop1(int fmt, int ft, int fs, int fd, int funct) {
+    return 0x11u << 26 | uint32_t(fmt) << 21 | uint32_t(ft) << 16 | uint32_t(fs) << 11 | uint32_t(fd) << 6
+           | uint32_t(funct);
+}
+
+enum Opcode : int {
+    SPECIAL = 0x00, REGIMM = 0x01, OP_J = 0x02, OP_BEQ = 0x04, OP_BNE = 0x05, OP_BLEZ = 0x06, OP_BGTZ = 0x07,
+    OP_ADDI = 0x08, OP_ADDIU = 0x09, OP_ORI = 0x0D, OP_LUI = 0x0F, SPECIAL2 = 0x1C,
+    OP_LW = 0x23, OP_SW = 0x2B, OP_LWC1 = 0x31, OP_SWC1 = 0x39,
+};
+
+enum Funct : int {
+    F_SLL = 0x00, F_SYSCALL = 0x0C, F_BREAK = 0x0D, F_MFLO = 0x12, F_MULT = 0x18, F_DIV = 0x1A,
+    F_ADD = 0x20, F_ADDU = 0x21, F_SUB = 0x22, F_SUBU = 0x23, F_OR = 0x25, F_SLT = 0x2A, F_SLTU = 0x2B,
+};
+
+/// @brief Encodes the blocks of a program into .text words
+class TextEncoder {
+public:
+    TextEncoder(const ir::Program &program, const std::unordered_map<std::string, uint32_t> &data_labels)
+        : program(program), data_labels(data_labels) {}
+
+    void encode() {
+        // expansions do not depend on label offsets, the first pass places the labels
+        for (resolving = false;; resolving = true) {
+            words.clear();
+            relocations.clear();
+            for (auto &bb: program.blocks) {
+                if (!bb.label.empty() && !resolving) {
+                    text_labels[bb.label] = offset();
+                    labels.emplace_back(bb.label, offset());
+                }
+                for (auto &instr: bb.instrs)
+                    encode(instr);
+            }
+            if (resolving)
+                return;
+        }
+    }
+
+    std::vector<uint32_t> words;
+    std::vector<Relocation> relocations;
+    std::vector<std::pair<std::string, uint32_t>> labels; // in program order
+
+private:
+    uint32_t offset() const { return uint32_t(words.size() * 4); }
+
+    void emit(uint32_t word) { words.push_back(word); }
+
+    [[noreturn]] void unsupported(const ir::Instr &instr) const {
+        throw std::runtime_error("can not encode " + instr.str());
+    }
+
+    int reg(const ir::Instr &instr, std::size_t i, bool fpu = false) const {
+        if (instr.operands.size() <= i || !instr.operands[i].is_reg())
+            unsupported(instr);
+        int index = register_index(instr.operands[i].text.substr(1));
+        int base = fpu ? FPR_BASE : 0;
+        if (index < base || index >= base + 32)
+            unsupported(instr);
+        return index - base;
+    }
+
+    int fpr(const ir::Instr &instr, std::size_t i) const { return reg(instr, i, true); }
+
+    int32_t imm(const ir::Instr &instr, std::size_t i) const {
+        if (instr.operands.size() <= i || !instr.operands[i].is_imm())
+            unsupported(instr);
+        long long value = std::stoll(instr.operands[i].text, nullptr, 0);
+        if (value < INT32_MIN || value > UINT32_MAX)
+            unsupported(instr);
+        return int32_t(uint32_t(value));
+    }
+
+    Address address(const std::string &text) const {
+        auto plus = text.find('+');
+        std::string symbol = text.substr(0, plus);
+        int32_t addend = plus == std::string::npos ? 0 : std::stoi(text.substr(plus + 1));
+        if (auto data = data_labels.find(symbol); data != data_labels.end())
+            return {DATA_SYMBOL, int32_t(data->second - DATA_BASE) + addend};
+        if (auto label = text_labels.find(symbol); label != text_labels.end())
+            return {TEXT_SYMBOL, int32_t(label->second) + addend};
+        if (resolving)
+            throw std::runtime_error("undefined symbol " + symbol);
+        return {TEXT_SYMBOL, 0};
+    }
+
+    /// @brief li: addiu, ori or lui with an ori for the low half when it is not zero
+    void load_immediate(int rd, int32_t value) {
+        if (fits16(value)) {
+            emit(i_type(OP_ADDIU, ZERO, rd, value));
+        } else if (value >= 0 && value <= 0xFFFF) {
+            emit(i_type(OP_ORI, ZERO, rd, value));
+        } else {
+            emit(i_type(OP_LUI, ZERO, rd, int32_t(uint32_t(value) >> 16)));
+            if ((value & 0xFFFF) != 0)
+                emit(i_type(OP_ORI, rd, rd, value & 0xFFFF));
+        }
+    }
+
+    /// @brief lui base, %hi(symbol) then the instruction with %lo(symbol)($base)
+    void absolute(int opcode, int base, int rt, const std::string &symbol) {
+        Address target = address(symbol);
+        relocations.push_back({offset(), target.symbol, R_MIPS_HI16});
+        emit(i_type(OP_LUI, ZERO, base, int32_t(uint32_t(target.addend + 0x8000) >> 16)));
+        relocations.push_back({offset(), target.symbol, R_MIPS_LO16});
+        emit(i_type(opcode, base, rt, target.addend));
+    }
+
+    /// @brief Word access of a symbol through base or of (register)
+    void memory(int opcode, int rt, int base, const ir::Instr &instr) {
+        auto &address = instr.operands[1];
+        if (address.is_mem())
+            emit(i_type(opcode, register_index(address.text.substr(1)), rt, 0));
+        else if (address.is_symbol())
+            absolute(opcode, base, rt, address.text);
+        else
+            unsupported(instr);
+    }
+
+    /// @brief add and sub with a register or immediate operand, sub negates the immediate
+    void add(const ir::Instr &instr, bool negate, bool unsigned_op) {
+        int rd = reg(instr, 0), rs = reg(instr, 1);
+        if (instr.operands.size() > 2 && instr.operands[2].is_reg()) {
+            int funct = negate ? (unsigned_op ? F_SUBU : F_SUB) : (unsigned_op ? F_ADDU : F_ADD);
+            emit(r_type(rs, reg(instr, 2), rd, 0, funct));
+            return;
+        }
+        int64_t value = imm(instr, 2);
+        if (negate)
+            value = -value;
+        if (fits16(value)) {
+            emit(i_type(unsigned_op ? OP_ADDIU : OP_ADDI, rs, rd, int32_t(value)));
+            return;
+        }
+        // the immediate goes to the destination unless it is the source
+        int funct = unsigned_op ? F_ADDU : F_ADD;
+        if (rd == rs) {
+            load_immediate(AT, int32_t(value));
+            emit(r_type(rd, AT, rd, 0, funct));
+        } else {
+            load_immediate(rd, int32_t(value));
+            emit(r_type(rd, rs, rd, 0, funct));
+        }
+    }
+
+    /// @return register holding the second operand of a compare, the immediate is loaded to $at
+    int compare_operand(const ir::Instr &instr) {
+        if (instr.operands.size() > 1 && instr.operands[1].is_reg())
+            return reg(instr, 1);
+        load_immediate(AT, imm(instr, 1));
+        return AT;
+    }
+
+    int32_t branch_offset(const ir::Instr &instr) const {
+        if (instr.operands.empty() || !instr.operands.back().is_symbol())
+            unsupported(instr);
+        auto found = text_labels.find(instr.operands.back().text);
+        if (!resolving)
+            return 0;
+        if (found == text_labels.end())
+            throw std::runtime_error("undefined label " + instr.operands.back().text);
+        int64_t delta = (int64_t(found->second) - int64_t(offset() + 4)) / 4;
+        if (!fits16(delta))
+            throw std::runtime_error("branch to " + found->first + " out of range");
+        return int32_t(delta);
+    }
+
+    void branch(int opcode, int rs, int rt, const ir::Instr &instr) {
+        emit(i_type(opcode, rs, rt, branch_offset(instr)));
+    }
+
+    /// @brief slt(u) $at of the operands in given order, then a branch on $at
+    void set_and_branch(const ir::Instr &instr, bool swap, bool is_unsigned, bool branch_if_set) {
+        int lhs = reg(instr, 0);
+        int rhs = compare_operand(instr);
+        if (swap)
+            std::swap(lhs, rhs);
+        emit(r_type(lhs, rhs, AT, 0, is_unsigned ? F_SLTU : F_SLT));
+        branch(branch_if_set ? OP_BNE : OP_BEQ, AT, ZERO, instr);
+    }
+
+    /// @brief div with the checks an assembler adds: break 7 on zero, break 6 on overflow
+    void divide(const ir::Instr &instr) {
+        int rd = reg(instr, 0), rs = reg(instr, 1);
+        if (instr.operands.size() > 2 && instr.operands[2].is_reg()) {
+            int rt = reg(instr, 2);
+            emit(i_type(OP_BNE, rt, ZERO, 2));
+            emit(r_type(rs, rt, ZERO, 0, F_DIV));
+            emit(r_type(0, 0, 0, 0, F_BREAK) | 7u << 16);
+            emit(i_type(OP_ADDIU, ZERO, AT, -1));
+            emit(i_type(OP_BNE, rt, AT, 4));
+            emit(i_type(OP_LUI, ZERO, AT, 0x8000));
+            emit(i_type(OP_BNE, rs, AT, 2));
+            emit(0); // nop
+            emit(r_type(0, 0, 0, 0, F_BREAK) | 6u << 16);
+            emit(r_type(0, 0, rd, 0, F_MFLO));
+            return;
+        }
+        int32_t divisor = imm(instr, 2);
+        if (divisor == 0) {
+            emit(r_type(0, 0, 0, 0, F_BREAK) | 7u << 16);
+        } else if (divisor == -1) {
+            emit(r_type(ZERO, rs, rd, 0, F_SUB));
+        } else if (divisor == 1) {
+            emit(r_type(rs, ZERO, rd, 0, F_OR));
+        } else {
+            load_immediate(AT, divisor);
+            emit(r_type(rs, AT, ZERO, 0, F_DIV));
+            emit(r_type(0, 0, rd, 0, F_MFLO));
+        }
+    }
+
+    void encode(const ir::Instr &instr) {
+        int opcode = find_opcode(instr.opcode);
+        if (opcode < 0)
+            unsupported(instr);
+        auto &ops = instr.operands;
+        constexpr int S = 0x10, W = 0x14;
+        switch (opcode) {
+            case LI: load_immediate(reg(instr, 0), imm(instr, 1)); break;
+            case LA:
+                if (ops.size() < 2 || !ops[1].is_symbol())
+                    unsupported(instr);
+                absolute(OP_ADDIU, reg(instr, 0), reg(instr, 0), ops[1].text);
+                break;
+            case MOVE: emit(r_type(reg(instr, 1), ZERO, reg(instr, 0), 0, F_OR)); break;
+            case MOV_S: emit(cop1(S, 0, fpr(instr, 1), fpr(instr, 0), 0x06)); break;
+            case ADD: case ADDI:
+                add(instr, false, instr.opcode == "addu" || instr.opcode == "addiu");
+                break;
+            case SUB: case SUBI: add(instr, true, instr.opcode == "subu"); break;
+            case MUL:
+                if (ops.size() > 2 && ops[2].is_reg()) {
+                    emit(uint32_t(SPECIAL2) << 26 | r_type(reg(instr, 1), reg(instr, 2), reg(instr, 0), 0, 0x02));
+                } else {
+                    load_immediate(AT, imm(instr, 2));
+                    emit(r_type(reg(instr, 1), AT, 0, 0, F_MULT));
+                    emit(r_type(0, 0, reg(instr, 0), 0, F_MFLO));
+                }
+                break;
+            case DIV: divide(instr); break;
+            case SLL: emit(r_type(0, reg(instr, 1), reg(instr, 0), imm(instr, 2) & 31, F_SLL)); break;
+            case ADD_S: emit(cop1(S, fpr(instr, 2), fpr(instr, 1), fpr(instr, 0), 0x00)); break;
+            case SUB_S: emit(cop1(S, fpr(instr, 2), fpr(instr, 1), fpr(instr, 0), 0x01)); break;
+            case MUL_S: emit(cop1(S, fpr(instr, 2), fpr(instr, 1), fpr(instr, 0), 0x02)); break;
+            case DIV_S: emit(cop1(S, fpr(instr, 2), fpr(instr, 1), fpr(instr, 0), 0x03)); break;
+            case MTC1: emit(cop1(0x04, reg(instr, 0), fpr(instr, 1), 0, 0)); break;
+            case MFC1: emit(cop1(0x00, reg(instr, 0), fpr(instr, 1), 0, 0)); break;
+            case CVT_S_W: emit(cop1(W, 0, fpr(instr, 1), fpr(instr, 0), 0x20)); break;
+            case CVT_W_S: emit(cop1(S, 0, fpr(instr, 1), fpr(instr, 0), 0x24)); break;
+            case LW: {
+                int rt = reg(instr, 0);
+                memory(OP_LW, rt, rt == ZERO ? AT : rt, instr);
+                break;
+            }
+            case SW: memory(OP_SW, reg(instr, 0), AT, instr); break;
+            case L_S: memory(OP_LWC1, fpr(instr, 0), AT, instr); break;
+            case S_S: memory(OP_SWC1, fpr(instr, 0), AT, instr); break;
+            case C_EQ_S: emit(cop1(S, fpr(instr, 1), fpr(instr, 0), 0, 0x32)); break;
+            case C_LT_S: emit(cop1(S, fpr(instr, 1), fpr(instr, 0), 0, 0x3C)); break;
+            case C_LE_S: emit(cop1(S, fpr(instr, 1), fpr(instr, 0), 0, 0x3E)); break;
+            case BC1T: case BC1F:
+                emit(cop1(0x08, opcode == BC1T ? 1 : 0, 0, 0, 0) | (uint32_t(branch_offset(instr)) & 0xFFFF));
+                break;
+            case BEQ: case BNE: {
+                int rs = reg(instr, 0);
+                int rt = ops.size() > 1 && ops[1].is_imm() && imm(instr, 1) == 0 ? ZERO : compare_operand(instr);
+                branch(opcode == BEQ ? OP_BEQ : OP_BNE, rs, rt, instr);
+                break;
+            }
+            case BLT: set_and_branch(instr, false, false, true); break;
+            case BGE: set_and_branch(instr, false, false, false); break;
+            case BLE: set_and_branch(instr, true, false, false); break;
+            case BGT: set_and_branch(instr, true, false, true); break;
+            case BGEU: set_and_branch(instr, false, true, false); break;
+            case BEQZ: branch(OP_BEQ, reg(instr, 0), ZERO, instr); break;
+            case BNEZ: branch(OP_BNE, reg(instr, 0), ZERO, instr); break;
+            case BLTZ: branch(REGIMM, reg(instr, 0), 0, instr); break;
+            case BGEZ: branch(REGIMM, reg(instr, 0), 1, instr); break;
+            case BLEZ: branch(OP_BLEZ, reg(instr, 0), 0, instr); break;
+            case BGTZ: branch(OP_BGTZ, reg(instr, 0), 0, instr); break;
+            case B: branch(OP_BEQ, ZERO, ZERO, instr); break;
+            case J: {
+                if (ops.empty() || !ops[0].is_symbol())
+                    unsupported(instr);
+                Address target = address(ops[0].text);
+                relocations.push_back({offset(), target.symbol, R_MIPS_26});
+                emit(uint32_t(OP_J) << 26 | (uint32_t(target.addend) >> 2 & 0x3FFFFFF));
+                break;
+            }
+            case SYSCALL: emit(r_type(0, 0, 0, 0, F_SYSCALL)); break;
+            case NOP: emit(0); break;
+            default: unsupported(instr);
+        }
+    }
+
+    const ir::Program &program;
+    const std::unordered_map<std::string, uint32_t> &data_labels;
+    std::unordered_map<std::string, uint32_t> text_labels;
+    bool resolving = false;
+};
+
+/// @brief Little-endian byte buffer
+class Buffer {
+public:
+    void u8(uint8_t value) { bytes.push_back(char(value)); }
+
+    void u16(uint16_t value) {
+        u8(uint8_t(value));
+        u8(uint8_t(value >> 8));
+    }
+
+    void u32(uint32_t value) {
+        u16(uint16_t(value));
+        u16(uint16_t(value >> 16));
+    }
+
+    void align(std::size_t alignment) { bytes.resize((bytes.size() + alignment - 1) / alignment * alignment); }
+
+    std::size_t size() const { return bytes.size(); }
+
+    std::string bytes;
+};
+
+/// @brief Null terminated names, offset 0 is the empty name
+class StringTable {
+public:
+    uint32_t add(const std::string &name) {
+        auto offset = uint32_t(strings.size());
+        strings += name;
+        strings += '\0';
+        return offset;
+    }
+
+    std::string strings{'\0'};
+};
+
+struct SectionHeader {
+    uint32_t name = 0;
+    uint32_t type = 0;
+    uint32_t flags = 0;
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    uint32_t link = 0;
+    uint32_t info = 0;
+    uint32_t alignment = 0;
+    uint32_t entry_size = 0;
+};
+
+enum : uint32_t { SHT_PROGBITS = 1, SHT_SYMTAB = 2, SHT_STRTAB = 3, SHT_REL = 9 };
+enum : uint32_t { SHF_WRITE = 0x1, SHF_ALLOC = 0x2, SHF_EXECINSTR = 0x4, SHF_INFO_LINK = 0x40 };
+enum : uint8_t { STT_NOTYPE = 0, STT_SECTION = 3 };
+
+constexpr uint32_t ELF_HEADER_SIZE = 52;
+constexpr uint32_t SECTION_HEADER_SIZE = 40;
+constexpr uint32_t EF_MIPS_NOREORDER = 0x1, EF_MIPS_ABI_O32 = 0x1000, EF_MIPS_ARCH_32 = 0x50000000;
+
+}
+
+void write_object(std::istream &data_region, const ir::Program &program, std::ostream &out) {
+    // the data region is a short list of directives, the listing reader lays it out like an assembler
+    Listing data;
+    data.load(data_region);
+    TextEncoder text(program, data.data_labels());
+    text.encode();
+
+    // every label is local, as in the listing, the data ones by address
+    std::vector<std::pair<std::string, uint32_t>> data_labels(data.data_labels().begin(), data.data_labels().end());
+    std::sort(data_labels.begin(), data_labels.end(), [](auto &lhs, auto &rhs) {
+        return std::tie(lhs.second, lhs.first) < std::tie(rhs.second, rhs.first);
+    });
+    StringTable names;
+    Buffer symbols;
+    auto add_symbol = [&](uint32_t name, uint32_t value, uint8_t type, uint16_t section) {
+        symbols.u32(name);
+        symbols.u32(value);
+        symbols.u32(0);
+        symbols.u8(type); // STB_LOCAL
+        symbols.u8(0);
+        symbols.u16(section);
+    };
+    add_symbol(0, 0, STT_NOTYPE, 0);
+    add_symbol(0, 0, STT_SECTION, TEXT);
+    add_symbol(0, 0, STT_SECTION, DATA);
+    for (auto &[name, address]: data_labels)
+        add_symbol(names.add(name), address - DATA_BASE, STT_NOTYPE, DATA);
+    for (auto &[name, offset]: text.labels)
+        add_symbol(names.add(name), offset, STT_NOTYPE, TEXT);
+
+    StringTable section_names;
+    SectionHeader headers[SECTION_COUNT];
+    const char *section_name[SECTION_COUNT] = {"", ".text", ".rel.text", ".data", ".symtab", ".strtab", ".shstrtab"};
+    for (int i = TEXT; i < SECTION_COUNT; i++)
+        headers[i].name = section_names.add(section_name[i]);
+
+    Buffer file;
+    file.bytes.resize(ELF_HEADER_SIZE);
+    auto place = [&](Section index, uint32_t type, uint32_t flags, const std::string &content, uint32_t alignment) {
+        file.align(alignment);
+        headers[index].type = type;
+        headers[index].flags = flags;
+        headers[index].offset = uint32_t(file.size());
+        headers[index].size = uint32_t(content.size());
+        headers[index].alignment = alignment;
+        file.bytes += content;
+    };
+
+    Buffer code;
+    for (uint32_t word: text.words)
+        code.u32(word);
+    place(TEXT, SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, code.bytes, 4);
+
+    Buffer relocations;
+    for (auto &relocation: text.relocations) {
+        relocations.u32(relocation.offset);
+        relocations.u32(relocation.symbol << 8 | relocation.type);
+    }
+    place(REL_TEXT, SHT_REL, SHF_INFO_LINK, relocations.bytes, 4);
+    headers[REL_TEXT].link = SYMTAB;
+    headers[REL_TEXT].info = TEXT;
+    headers[REL_TEXT].entry_size = 8;
+
+    place(DATA, SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, std::string(data.memory.begin(), data.memory.end()), 4);
+
+    place(SYMTAB, SHT_SYMTAB, 0, symbols.bytes, 4);
+    headers[SYMTAB].link = STRTAB;
+    headers[SYMTAB].info = uint32_t(symbols.size() / 16); // index of the first global symbol, there are none
+    headers[SYMTAB].entry_size = 16;
+
+    place(STRTAB, SHT_STRTAB, 0, names.strings, 1);
+    place(SHSTRTAB, SHT_STRTAB, 0, section_names.strings, 1);
+
+    file.align(4);
+    auto section_headers = uint32_t(file.size());
+    for (auto &header: headers) {
+        file.u32(header.name);
+        file.u32(header.type);
+        file.u32(header.flags);
+        file.u32(0); // address
+        file.u32(header.offset);
+        file.u32(header.size);
+        file.u32(header.link);
+        file.u32(header.info);
+        file.u32(header.alignment);
+        file.u32(header.entry_size);
+    }
+
+    Buffer elf_header;
+    for (char c: std::string("\x7f" "ELF"))
+        elf_header.u8(uint8_t(c));
+    elf_header.u8(1); // ELFCLASS32
+    elf_header.u8(1); // ELFDATA2LSB
+    elf_header.u8(1); // EV_CURRENT
+    elf_header.align(16);
+    elf_header.u16(1); // ET_REL
+    elf_header.u16(8); // EM_MIPS
+    elf_header.u32(1); // EV_CURRENT
+    elf_header.u32(0); // entry
+    elf_header.u32(0); // program headers
+    elf_header.u32(section_headers);
+    elf_header.u32(EF_MIPS_NOREORDER | EF_MIPS_ABI_O32 | EF_MIPS_ARCH_32);
+    elf_header.u16(ELF_HEADER_SIZE);
+    elf_header.u16(0);
+    elf_header.u16(0);
+    elf_header.u16(SECTION_HEADER_SIZE);
+    elf_header.u16(SECTION_COUNT);
+    elf_header.u16(SHSTRTAB);
+    file.bytes.replace(0, ELF_HEADER_SIZE, elf_header.bytes);
+
+    out.write(file.bytes.data(), std::streamsize(file.size()));
+}
+
+}
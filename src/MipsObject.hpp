@@ -0,0 +1,16 @@
+#pragma once
+#include <iostream>
+
+#include "Ir.hpp"
+
+namespace mips {
+
+/// @brief Writes a compiled program as a relocatable little-endian ELF32 MIPS object with
+/// .data, .text, their labels as local symbols and REL relocations of the data addresses and
+/// jumps. Pseudo-instructions are expanded as an assembler does under .set noreorder, with
+/// $at as scratch register, and branch offsets are resolved here.
+/// @param data_region .data: listing written by Compiler::write_data_region
+/// @throws std::runtime_error on undefined symbols and operands an instruction can not encode
+void write_object(std::istream &data_region, const ir::Program &program, std::ostream &out);
+
+}
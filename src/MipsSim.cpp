@@ -0,0 +1,211 @@
+#include "MipsSim.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+using namespace mips;
+
+namespace {
+
+bool fits16(int32_t value) {
+    return value >= -32768 && value <= 32767;
+}
+
+}
+
+void MipsSim::load(std::istream &source) {
+    mips::Listing listing;
+    listing.load(source);
+    memory = std::move(listing.memory);
+    text = std::move(listing.text);
+}
+
+uint32_t MipsSim::address_of(const Operand &op) const {
+    if (op.kind == OperandKind::MEM)
+        return uint32_t(regs[op.reg] + op.value);
+    return uint32_t(op.value);
+}
+
+int32_t MipsSim::value_of(const Operand &op) const {
+    if (op.kind == OperandKind::REG)
+        return op.reg == 0 ? 0 : regs[op.reg];
+    return op.value;
+}
+
+uint32_t &MipsSim::word_at(uint32_t address) {
+    if (address % 4 != 0)
+        throw std::runtime_error("unaligned memory access");
+    if (address < DATA_BASE || address + 4 > DATA_BASE + memory.size())
+        throw std::runtime_error("memory access out of the data segment");
+    return *reinterpret_cast<uint32_t *>(&memory[address - DATA_BASE]);
+}
+
+void MipsSim::run(std::ostream &out, uint64_t max_steps) {
+    pc = 0;
+    run_stats = {};
+    while (pc < text.size()) {
+        if (run_stats.instructions >= max_steps)
+            throw std::runtime_error("step limit exceeded");
+        const Instruction &instr = text[pc];
+        try {
+            step(instr, out);
+        } catch (const std::runtime_error &e) {
+            fail(instr.line, e.what());
+        }
+        if (pc == UINT32_MAX)
+            break; // exit syscall
+    }
+}
+
+void MipsSim::step(const Instruction &instr, std::ostream &out) {
+    auto &ops = instr.operands;
+    auto reg = [&](int i) -> int32_t & {
+        if (ops.size() <= std::size_t(i) || ops[i].kind != OperandKind::REG)
+            throw std::runtime_error("register operand expected");
+        return regs[ops[i].reg];
+    };
+    auto fpr = [&](int i) { return as_float(reg(i)); };
+    auto checked = [](int64_t value) {
+        if (value < INT32_MIN || value > INT32_MAX)
+            throw std::runtime_error("arithmetic overflow");
+        return int32_t(value);
+    };
+
+    uint32_t next_pc = pc + 1;
+    bool taken = false;
+    bool is_branch = false;
+
+    auto branch = [&](bool condition) {
+        is_branch = true;
+        if (condition) {
+            taken = true;
+            next_pc = uint32_t(ops.back().value);
+        }
+    };
+
+    switch (instr.opcode) {
+        case LI: reg(0) = ops[1].value; break;
+        case LA: reg(0) = int32_t(address_of(ops[1])); break;
+        case MOVE: case MOV_S: reg(0) = reg(1); break;
+        case ADD: case ADDI: reg(0) = checked(int64_t(reg(1)) + value_of(ops[2])); break;
+        case SUB: reg(0) = checked(int64_t(reg(1)) - value_of(ops[2])); break;
+        case SUBI: reg(0) = checked(int64_t(reg(1)) - ops[2].value); break;
+        case MUL: reg(0) = int32_t(uint32_t(reg(1)) * uint32_t(value_of(ops[2]))); break;
+        case DIV: {
+            int32_t divisor = value_of(ops[2]);
+            if (divisor == 0)
+                throw std::runtime_error("division by zero");
+            reg(0) = (reg(1) == INT32_MIN && divisor == -1) ? INT32_MIN : reg(1) / divisor;
+            break;
+        }
+        case SLL: reg(0) = int32_t(uint32_t(reg(1)) << (ops[2].value & 31)); break;
+        case ADD_S: reg(0) = as_bits(fpr(1) + fpr(2)); break;
+        case SUB_S: reg(0) = as_bits(fpr(1) - fpr(2)); break;
+        case MUL_S: reg(0) = as_bits(fpr(1) * fpr(2)); break;
+        case DIV_S: reg(0) = as_bits(fpr(1) / fpr(2)); break;
+        case MTC1: reg(1) = reg(0); break;
+        case MFC1: reg(0) = reg(1); break;
+        case CVT_S_W: reg(0) = as_bits(float(reg(1))); break;
+        case CVT_W_S: {
+            float f = fpr(1);
+            reg(0) = (std::isnan(f) || f >= 2147483648.0f || f < -2147483648.0f)
+                     ? INT32_MAX : int32_t(std::nearbyint(f));
+            break;
+        }
+        case LW: case L_S: reg(0) = int32_t(word_at(address_of(ops[1]))); run_stats.loads++; break;
+        case SW: case S_S: word_at(address_of(ops[1])) = uint32_t(reg(0)); run_stats.stores++; break;
+        case C_EQ_S: regs[FLAG] = fpr(0) == fpr(1); break;
+        case C_LT_S: regs[FLAG] = fpr(0) < fpr(1); break;
+        case C_LE_S: regs[FLAG] = fpr(0) <= fpr(1); break;
+        case BC1T: branch(regs[FLAG] != 0); break;
+        case BC1F: branch(regs[FLAG] == 0); break;
+        case BEQ: branch(reg(0) == value_of(ops[1])); break;
+        case BNE: branch(reg(0) != value_of(ops[1])); break;
+        case BLT: branch(reg(0) < value_of(ops[1])); break;
+        case BLE: branch(reg(0) <= value_of(ops[1])); break;
+        case BGT: branch(reg(0) > value_of(ops[1])); break;
+        case BGE: branch(reg(0) >= value_of(ops[1])); break;
+        case BGEU: branch(uint32_t(reg(0)) >= uint32_t(value_of(ops[1]))); break;
+        case BEQZ: branch(reg(0) == 0); break;
+        case BNEZ: branch(reg(0) != 0); break;
+        case BLTZ: branch(reg(0) < 0); break;
+        case BLEZ: branch(reg(0) <= 0); break;
+        case BGTZ: branch(reg(0) > 0); break;
+        case BGEZ: branch(reg(0) >= 0); break;
+        case B: case J: branch(true); break;
+        case SYSCALL:
+            run_stats.syscalls++;
+            switch (regs[2]) {
+                case 1: out << regs[4]; break;
+                case 2: out << as_float(regs[FPR_BASE + 12]); break;
+                case 4: {
+                    uint32_t address = uint32_t(regs[4]);
+                    while (true) {
+                        if (address < DATA_BASE || address >= DATA_BASE + memory.size())
+                            throw std::runtime_error("string out of the data segment");
+                        char c = char(memory[address - DATA_BASE]);
+                        if (c == '\0')
+                            break;
+                        out << c;
+                        address++;
+                    }
+                    break;
+                }
+                case 10: next_pc = UINT32_MAX; break;
+                case 11: out << char(regs[4]); break;
+                default: throw std::runtime_error("unsupported syscall " + std::to_string(regs[2]));
+            }
+            break;
+        case NOP: break;
+    }
+    regs[0] = 0;
+
+    run_stats.instructions++;
+    if (is_branch) {
+        run_stats.branches++;
+        if (taken)
+            run_stats.branches_taken++;
+    }
+    run_stats.cycles += cycle_cost(instr, taken);
+    pc = next_pc;
+}
+
+int MipsSim::cycle_cost(const Instruction &instr, bool taken) {
+    // Rough single issue pipeline: pseudo instructions cost their expansion, loads have
+    // one use delay cycle, taken branches flush one fetched instruction, multi-cycle
+    // units stall until the result is ready.
+    auto &ops = instr.operands;
+    auto imm_extra = [&](std::size_t i) {
+        return ops.size() > i && ops[i].kind == OperandKind::IMM && !fits16(ops[i].value) ? 1 : 0;
+    };
+    auto addr_extra = [&](std::size_t i) {
+        return ops.size() > i && ops[i].kind == OperandKind::ADDR ? 1 : 0;
+    };
+    auto imm_operand = [&](std::size_t i) {
+        return ops.size() > i && ops[i].kind == OperandKind::IMM ? 1 : 0;
+    };
+
+    switch (instr.opcode) {
+        case LI: return 1 + imm_extra(1);
+        case LA: return 2;
+        case MOVE: case MOV_S: case MTC1: case MFC1: case SLL: case NOP: return 1;
+        case ADD: case SUB: case ADDI: case SUBI: return 1 + imm_extra(2);
+        case MUL: return 4 + imm_operand(2) + imm_extra(2);
+        case DIV: return 35 + 2 + imm_operand(2) + imm_extra(2);
+        case ADD_S: case SUB_S: return 2;
+        case MUL_S: return 4;
+        case DIV_S: return 12;
+        case CVT_S_W: case CVT_W_S: return 2;
+        case LW: case L_S: return 2 + addr_extra(1);
+        case SW: case S_S: return 1 + addr_extra(1);
+        case C_EQ_S: case C_LT_S: case C_LE_S: return 1;
+        case BC1T: case BC1F: case BEQ: case BNE:
+        case BEQZ: case BNEZ: case BLTZ: case BLEZ: case BGTZ: case BGEZ: case B: case J:
+            return 1 + imm_operand(1) + (taken ? 1 : 0);
+        case BLT: case BLE: case BGT: case BGE: case BGEU: // slt(u) + beq/bne
+            return 2 + imm_operand(1) + (taken ? 1 : 0);
+        case SYSCALL: return 1;
+    }
+    return 1;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "MipsListing.hpp"
+
+/// @brief Interpreter for the MIPS subset emitted by Compiler with SPIM-like syscalls
+class MipsSim {
+public:
+    struct Stats {
+        uint64_t instructions = 0;    // retired source level (pseudo) instructions
+        uint64_t loads = 0;
+        uint64_t stores = 0;
+        uint64_t branches = 0;        // executed conditional branches and jumps
+        uint64_t branches_taken = 0;
+        uint64_t syscalls = 0;
+        uint64_t cycles = 0;          // estimate, see cycle_cost()
+    };
+
+    /// @brief Parses the .data:/.text: listing produced by the compiler
+    /// @throws std::runtime_error on unsupported syntax
+    void load(std::istream &source);
+
+    /// @brief Executes the program from the first text line until it runs off the end
+    /// @throws std::runtime_error on runtime faults or when max_steps is exceeded
+    void run(std::ostream &out, uint64_t max_steps = 1'000'000'000);
+
+    const Stats &stats() const { return run_stats; }
+
+    std::size_t text_size() const { return text.size(); }
+
+    std::size_t data_size() const { return memory.size(); }
+
+private:
+    using Operand = mips::Operand;
+    using Instruction = mips::Instruction;
+
+    uint32_t address_of(const Operand &op) const;
+
+    int32_t value_of(const Operand &op) const;
+
+    uint32_t &word_at(uint32_t address);
+
+    void step(const Instruction &instr, std::ostream &out);
+
+    static int cycle_cost(const Instruction &instr, bool taken);
+
+    std::vector<uint8_t> memory;
+    std::vector<Instruction> text;
+
+    int32_t regs[mips::REGISTER_COUNT] = {}; // GPRs, FPRs as raw bits, condition flag
+    uint32_t pc = 0;
+    Stats run_stats;
+};
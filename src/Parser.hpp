@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+
+class Compiler;
+
+/// @brief Source the scanner works on in place: size bytes of text followed by two NUL bytes,
+/// all writable as flex marks the end of the current token in the buffer while scanning.
+/// Tokens are spans of the buffer, identifiers and literals are only copied when interned.
+struct ScanBuffer {
+    char *data;
+    std::size_t size;
+
+    std::string_view text() const { return {data, size}; }
+};
+
+/// @brief Scans and parses one program, code is generated into given compiler instance.
+/// Every call owns its own scanner and parser state so programs can be parsed concurrently.
+/// @throws std::runtime_error on lexical, syntax and semantic errors, message starts with the line number
+void parse_program(ScanBuffer source, Compiler &compiler);
+
+/// @brief Same as above for a source which is copied to a buffer of the scanner first
+void parse_program(std::string_view source, Compiler &compiler);
+
+/// @brief Same as above, but the source is read from input in chunks as the parser needs it
+void parse_program(std::FILE *input, Compiler &compiler);
+
+/// @brief Only scans source, identifiers and literals are interned into compiler as when parsing
+/// @return number of tokens
+/// @throws std::runtime_error on lexical errors
+std::size_t scan_tokens(ScanBuffer source, Compiler &compiler);
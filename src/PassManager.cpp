@@ -0,0 +1,133 @@
+#include "PassManager.hpp"
+#include "BoundsCheck.hpp"
+#include "BlockLayout.hpp"
+#include "DeadStores.hpp"
+#include "Peephole.hpp"
+#include "ScalarPromotion.hpp"
+#include "Licm.hpp"
+#include "LoopUnroll.hpp"
+#include "StrengthReduction.hpp"
+#include "TempSlots.hpp"
+#include "ValueNumbering.hpp"
+#include "Trace.hpp"
+
+void PassStats::add(const std::string &counter, long value) {
+    for (auto &entry: values) {
+        if (entry.first == counter) {
+            entry.second += value;
+            return;
+        }
+    }
+    values.emplace_back(counter, value);
+}
+
+PassManager::PassManager(const OptOptions &options) : options(options) {}
+
+void PassManager::add(const std::string &name, int min_opt_level, Pass pass) {
+    passes.push_back({name, min_opt_level, std::move(pass)});
+}
+
+void PassManager::run(ir::Program &program, std::ostream &dump_stream) {
+    if (options.dump_ir) {
+        dump_stream << "; IR before optimization (" << program.instr_count() << " instructions)" << std::endl;
+        program.dump(dump_stream);
+    }
+
+    for (auto &entry: passes) {
+        if (options.opt_level < entry.min_opt_level)
+            continue;
+
+        std::size_t instr_count = program.instr_count();
+        PassStats stats;
+        {
+            trace::Span span(entry.name.c_str());
+            entry.pass(program, stats);
+            program.remove_empty_blocks();
+        }
+
+        if (options.print_stats) {
+            dump_stream << entry.name << ": " << long(instr_count) - long(program.instr_count())
+                    << " instructions removed" << std::endl;
+            for (auto &[counter, value]: stats.counters())
+                dump_stream << "    " << counter << ": " << value << std::endl;
+        }
+
+        if (options.dump_ir) {
+            dump_stream << std::endl << "; IR after " << entry.name
+                    << " (" << program.instr_count() << " instructions)" << std::endl;
+            program.dump(dump_stream);
+        }
+    }
+}
+
+PassManager PassManager::create_default(const OptOptions &options, bool whole_program) {
+    PassManager pm(options);
+    pm.add("remove-unreachable", 1, passes::remove_unreachable_blocks);
+    pm.add("peephole", 1, passes::peephole);
+    // after peephole, which turns the loop bounds into the immediates counted loops compare with
+    if (options.bounds_check) {
+        pm.add("bounds-checks", 1, passes::eliminate_bounds_checks);
+        // the removed checks split blocks the first peephole had to look at separately
+        pm.add("peephole", 1, passes::peephole);
+    }
+    pm.add("value-numbering", 1, passes::number_values);
+    // before the loop passes, array addresses they keep in registers across blocks count as needed
+    pm.add("dead-stores", 1, [whole_program](ir::Program &program, PassStats &stats) {
+        passes::eliminate_dead_stores(program, stats, whole_program);
+    });
+    pm.add("peephole", 1, passes::peephole);
+    pm.add("licm", 2, passes::licm);
+    pm.add("peephole", 2, passes::peephole);
+    pm.add("strength-reduction", 2, passes::strength_reduce_ivs);
+    pm.add("peephole", 2, passes::peephole);
+    pm.add("unroll", 2, [factor = options.unroll_factor, budget = options.unroll_budget](
+            ir::Program &program, PassStats &stats) {
+        passes::unroll_loops(program, stats, factor, budget);
+    });
+    // last of the control flow passes, the loop passes match the layout the compiler emits
+    pm.add("block-layout", 1, passes::layout_blocks);
+    pm.add("promote-scalars", 1, passes::promote_loop_scalars);
+    // forwards the stores before a loop to its register loads, they do not read the memory then
+    pm.add("peephole", 1, passes::peephole);
+    // again for the loads the loop passes hoisted next to the stores they read
+    pm.add("value-numbering", 1, passes::number_values);
+    // again for the stores whose loads the loop passes forwarded and for the write-backs of
+    // promoted variables nothing reads after the loop
+    pm.add("dead-stores", 1, [whole_program](ir::Program &program, PassStats &stats) {
+        passes::eliminate_dead_stores(program, stats, whole_program);
+    });
+    pm.add("peephole", 1, passes::peephole);
+    pm.add("pack-temporaries", 1, passes::pack_temporary_slots);
+    return pm;
+}
+
+namespace passes {
+
+void remove_unreachable_blocks(ir::Program &program, PassStats &stats) {
+    std::vector<bool> reachable(program.blocks.size(), false);
+    std::vector<int> worklist = {0};
+    reachable[0] = true;
+
+    while (!worklist.empty()) {
+        int block = worklist.back();
+        worklist.pop_back();
+        for (int succ: program.successors(block)) {
+            if (!reachable[succ]) {
+                reachable[succ] = true;
+                worklist.push_back(succ);
+            }
+        }
+    }
+
+    std::vector<ir::BasicBlock> kept;
+    kept.reserve(program.blocks.size());
+    for (std::size_t i = 0; i < program.blocks.size(); i++) {
+        if (reachable[i])
+            kept.push_back(std::move(program.blocks[i]));
+        else
+            stats.add("blocks removed", 1);
+    }
+    program.blocks = std::move(kept);
+}
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Ir.hpp"
+
+struct OptOptions {
+    int opt_level = 0; // 0 runs no pass, the code generator output is written as it is
+    bool dump_ir = false; // print the IR after every pass to the dump stream
+    bool print_stats = false; // print instruction counts removed by every pass to the dump stream
+    int unroll_factor = 4; // bodies per iteration of partially unrolled loops, below 2 disables it
+    int unroll_budget = 64; // maximum instructions of an unrolled loop
+    bool bounds_check = false; // check array indices at run time, the ones proven in bounds are removed
+};
+
+/// @brief Named counters reported by a pass, e.g. instructions removed by each rewrite rule
+class PassStats {
+public:
+    void add(const std::string &counter, long value);
+
+    const std::vector<std::pair<std::string, long>> &counters() const { return values; }
+
+private:
+    std::vector<std::pair<std::string, long>> values;
+};
+
+class PassManager {
+public:
+    using Pass = std::function<void(ir::Program &program, PassStats &stats)>;
+
+    explicit PassManager(const OptOptions &options);
+
+    /// @brief Registers pass which runs only when optimization level is at least min_opt_level
+    void add(const std::string &name, int min_opt_level, Pass pass);
+
+    void run(ir::Program &program, std::ostream &dump_stream);
+
+    /// @brief Pipeline used by the compiler driver for the given options
+    /// @param whole_program false when statements are optimized one by one while streaming
+    static PassManager create_default(const OptOptions &options, bool whole_program = true);
+
+private:
+    struct PassEntry {
+        std::string name;
+        int min_opt_level;
+        Pass pass;
+    };
+
+    OptOptions options;
+    std::vector<PassEntry> passes;
+};
+
+namespace passes {
+
+/// @brief Removes blocks which can not be reached from the program entry
+void remove_unreachable_blocks(ir::Program &program, PassStats &stats);
+
+}
@@ -0,0 +1,504 @@
+#include "Peephole.hpp"
+#include "Liveness.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+namespace passes {
+
+namespace {
+
+struct PeepholeContext {
+    ir::Program &program;
+    int block;
+    std::size_t idx;
+    const std::vector<ir::RegSet> &live_after;
+
+    std::vector<ir::Instr> &instrs() { return program.blocks[block].instrs; }
+
+    ir::Instr &instr() { return instrs()[idx]; }
+
+    bool has_next() { return idx + 1 < instrs().size(); }
+
+    ir::Instr &next() { return instrs()[idx + 1]; }
+
+    void erase(std::size_t i) { instrs().erase(instrs().begin() + long(i)); }
+};
+
+struct PeepholeRule {
+    const char *name;
+    bool (*apply)(PeepholeContext &ctx);
+};
+
+std::optional<int32_t> imm_value(const ir::Operand &op) {
+    if (!op.is_imm())
+        return std::nullopt;
+    try {
+        return std::stoi(op.text);
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+bool defines(const ir::Instr &instr, const std::string &reg) {
+    for (auto &def: instr.defs()) {
+        if (def == reg)
+            return true;
+    }
+    return false;
+}
+
+bool is_live_after(const PeepholeContext &ctx, std::size_t idx, const std::string &reg) {
+    int bit = ir::reg_bit(reg);
+    return bit < 0 || ctx.live_after[idx].test(bit);
+}
+
+/// @brief Instruction of form "op r, r, imm" on integer registers
+bool is_int_imm_update(const ir::Instr &instr, const char *opcode) {
+    return instr.opcode == opcode && instr.operands.size() == 3
+           && instr.operands[0].is_reg() && instr.operands[0] == instr.operands[1]
+           && instr.operands[2].is_imm();
+}
+
+std::optional<int32_t> eval_int(const std::string &opcode, int64_t l, int64_t r) {
+    int64_t result;
+    if (ir::additive_sign(opcode) != 0) {
+        result = l + ir::additive_sign(opcode) * r;
+    } else if (opcode == "mul") {
+        return int32_t(uint32_t(uint64_t(l) * uint64_t(r)));
+    } else if (opcode == "sll") {
+        return int32_t(uint32_t(l) << (r & 31));
+    } else {
+        return std::nullopt;
+    }
+    // add and sub trap on overflow, keep them for the runtime
+    if (result < INT32_MIN || result > INT32_MAX)
+        return std::nullopt;
+    return int32_t(result);
+}
+
+const std::string *next_label(const ir::Program &program, int block) {
+    for (std::size_t b = block + 1; b < program.blocks.size(); b++) {
+        if (!program.blocks[b].label.empty())
+            return &program.blocks[b].label;
+        if (!program.blocks[b].instrs.empty())
+            return nullptr;
+    }
+    return nullptr;
+}
+
+// b L / bxx ..., L right before L
+bool rule_jump_to_next(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (ctx.has_next() || !instr.is_terminator())
+        return false;
+    auto label = next_label(ctx.program, ctx.block);
+    if (label == nullptr || *label != instr.target())
+        return false;
+    ctx.erase(ctx.idx);
+    return true;
+}
+
+// add r, r, 0 / mul r, r, 1 / move r, r
+bool rule_noop_arithmetic(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    auto &ops = instr.operands;
+    if (ir::is_copy(instr.opcode) && ops[0] == ops[1]) {
+        ctx.erase(ctx.idx);
+        return true;
+    }
+    if (ops.size() != 3 || !ops[0].is_reg() || !ops[1].is_reg())
+        return false;
+
+    auto imm = imm_value(ops[2]);
+    if (!imm.has_value())
+        return false;
+
+    bool identity = ((ir::additive_sign(instr.opcode) != 0 || instr.opcode == "sll") && imm == 0)
+                    || ((instr.opcode == "mul" || instr.opcode == "div") && imm == 1);
+    if (!identity)
+        return false;
+
+    if (ops[0] == ops[1])
+        ctx.erase(ctx.idx);
+    else
+        instr = ir::Instr("move", {ops[0], ops[1]});
+    return true;
+}
+
+// mul r, r, A; mul r, r, B -> mul r, r, A*B (same for add when A and B do not have opposite signs)
+bool rule_fold_imm_chain(PeepholeContext &ctx) {
+    if (!ctx.has_next())
+        return false;
+    auto &instr = ctx.instr();
+    auto &next = ctx.next();
+    if (instr.opcode != next.opcode || (instr.opcode != "mul" && instr.opcode != "add")
+        || !is_int_imm_update(instr, instr.opcode.c_str()) || !is_int_imm_update(next, next.opcode.c_str())
+        || instr.operands[0] != next.operands[0])
+        return false;
+
+    auto a = imm_value(instr.operands[2]);
+    auto b = imm_value(next.operands[2]);
+    if (!a.has_value() || !b.has_value())
+        return false;
+
+    // mul wraps around. add traps on overflow: with A and B of one sign, r + A + B overflows
+    // exactly when r + A or the following + B does, with opposite signs r + A may trap alone.
+    if (instr.opcode == "add" && int64_t(a.value()) * b.value() < 0)
+        return false;
+    auto result = eval_int(instr.opcode, a.value(), b.value());
+    if (!result.has_value())
+        return false;
+
+    instr.operands[2] = ir::Operand(result.value());
+    ctx.erase(ctx.idx + 1);
+    return true;
+}
+
+// mul r, s, 2^k -> sll r, s, k
+bool rule_mul_to_shift(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (instr.opcode != "mul" || instr.operands.size() != 3 || !instr.operands[1].is_reg())
+        return false;
+    auto imm = imm_value(instr.operands[2]);
+    if (!imm.has_value() || imm.value() <= 1 || (imm.value() & (imm.value() - 1)) != 0)
+        return false;
+
+    int shift = 0;
+    while ((1 << shift) != imm.value())
+        shift++;
+    instr.opcode = "sll";
+    instr.operands[2] = ir::Operand(shift);
+    return true;
+}
+
+// li r, C; op r, r, K -> li r, C op K
+// li r, C; op d, s, r -> op d, s, C when r dies
+bool rule_propagate_li(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (instr.opcode != "li" || !ctx.has_next())
+        return false;
+    auto c = imm_value(instr.operands[1]);
+    if (!c.has_value())
+        return false;
+
+    auto &reg = instr.operands[0];
+    auto &next = ctx.next();
+    auto &ops = next.operands;
+
+    if (ops.size() == 3 && ops[0] == reg && ops[1] == reg && ops[2].is_imm()) {
+        auto k = imm_value(ops[2]);
+        if (!k.has_value())
+            return false;
+        auto result = eval_int(next.opcode, c.value(), k.value());
+        if (!result.has_value())
+            return false;
+        instr.operands[1] = ir::Operand(result.value());
+        ctx.erase(ctx.idx + 1);
+        return true;
+    }
+
+    if (is_live_after(ctx, ctx.idx + 1, reg.text) && !defines(next, reg.text))
+        return false;
+
+    bool arithmetic = next.opcode == "add" || next.opcode == "sub"
+                      || next.opcode == "mul" || next.opcode == "div";
+    if (arithmetic && ops.size() == 3 && ops[2] == reg && ops[1] != reg) {
+        ops[2] = ir::Operand(c.value());
+        ctx.erase(ctx.idx);
+        return true;
+    }
+    // the register is compared against the constant
+    if (next.is_branch() && ops.size() == 3 && ops[1] == reg && ops[0] != reg) {
+        ops[1] = ir::Operand(c.value());
+        ctx.erase(ctx.idx);
+        return true;
+    }
+    if (next.opcode == "move" && ops[1] == reg) {
+        next = ir::Instr("li", {ops[0], ir::Operand(c.value())});
+        ctx.erase(ctx.idx);
+        return true;
+    }
+    return false;
+}
+
+// li r, C ... li r, C with r unchanged in between
+bool rule_redundant_li(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (instr.opcode != "li")
+        return false;
+    auto &instrs = ctx.instrs();
+    for (std::size_t k = ctx.idx; k-- > 0;) {
+        auto &prev = instrs[k];
+        if (prev.opcode == "li" && prev.operands[0] == instr.operands[0]) {
+            if (prev.operands[1] != instr.operands[1])
+                return false;
+            ctx.erase(ctx.idx);
+            return true;
+        }
+        if (defines(prev, instr.operands[0].text))
+            return false;
+    }
+    return false;
+}
+
+// la r, S; add r, r, K -> la r, S+K
+bool rule_fold_address_offset(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (instr.opcode != "la" || !ctx.has_next() || !is_int_imm_update(ctx.next(), "add")
+        || ctx.next().operands[0] != instr.operands[0])
+        return false;
+    auto k = imm_value(ctx.next().operands[2]);
+    if (!k.has_value())
+        return false;
+
+    std::string symbol = instr.operands[1].text;
+    int32_t offset = k.value();
+    auto plus = symbol.find('+');
+    if (plus != std::string::npos) {
+        offset += std::stoi(symbol.substr(plus + 1));
+        symbol.resize(plus);
+    }
+    instr.operands[1] = ir::Operand(offset == 0 ? symbol : symbol + "+" + std::to_string(offset));
+    ctx.erase(ctx.idx + 1);
+    return true;
+}
+
+// sw r, X ... lw r2, X -> move r2, r and lw r, X ... lw r2, X -> move r2, r
+bool rule_redundant_load(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (!instr.is_store() && !instr.is_load())
+        return false;
+
+    const std::string value_reg = instr.operands[0].text;
+    const ir::Operand address = instr.operands[1];
+    if (instr.is_load() && address.is_mem() && address.text == value_reg)
+        return false; // lw r, (r) overwrites its own address
+
+    bool is_float = ir::is_float_access(instr.opcode);
+    const char *load_opcode = is_float ? "l.s" : "lw";
+    auto &instrs = ctx.instrs();
+
+    for (std::size_t j = ctx.idx + 1; j < instrs.size(); j++) {
+        auto &other = instrs[j];
+        if (other.opcode == load_opcode && other.operands[1] == address) {
+            if (other.operands[0].text == value_reg)
+                ctx.erase(j);
+            else
+                other = ir::Instr(is_float ? "mov.s" : "move", {other.operands[0], value_reg});
+            return true;
+        }
+        if (other.is_store()) {
+            // symbols are only written by name, any indirect store can alias an indirect load
+            if (other.operands[1] == address || (address.is_mem() && other.operands[1].is_mem()))
+                return false;
+        }
+        if (defines(other, value_reg) || (address.is_mem() && defines(other, address.text)))
+            return false;
+        if (other.is_terminator())
+            return false;
+    }
+    return false;
+}
+
+// move d, s; op x, d, y -> move d, s; op x, s, y while neither d nor s changes
+bool rule_propagate_copy(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (!ir::is_copy(instr.opcode) || instr.operands[0] == instr.operands[1])
+        return false;
+
+    const std::string dest = instr.operands[0].text;
+    const std::string source = instr.operands[1].text;
+    auto &instrs = ctx.instrs();
+    bool replaced = false;
+    for (std::size_t j = ctx.idx + 1; j < instrs.size(); j++) {
+        auto &other = instrs[j];
+        int def_operand = other.info().def_operand;
+        for (int k = 0; k < int(other.operands.size()); k++) {
+            auto &op = other.operands[k];
+            if (op.text == dest && (op.is_mem() || (op.is_reg() && k != def_operand))) {
+                op.text = source;
+                replaced = true;
+            }
+        }
+        if (defines(other, dest) || defines(other, source))
+            break;
+    }
+    return replaced;
+}
+
+// op t, a, b; move d, t -> op d, a, b, the later reads of t read d up to where t dies
+bool rule_coalesce_copy(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (!ctx.has_next() || instr.info().def_operand != 0 || instr.defs().size() != 1
+        || (!instr.is_load() && instr.info().kind != ir::OpInfo::Kind::ARITHMETIC))
+        return false;
+    auto &next = ctx.next();
+    if (!ir::is_copy(next.opcode) || next.operands[1] != instr.operands[0]
+        || next.operands[0] == next.operands[1])
+        return false;
+    const std::string temp = instr.operands[0].text;
+    const std::string dest = next.operands[0].text;
+
+    auto &instrs = ctx.instrs();
+    std::vector<std::pair<std::size_t, int>> reads;
+    bool dest_changed = false;
+    bool temp_dies = false;
+    for (std::size_t j = ctx.idx + 2; j < instrs.size() && !temp_dies; j++) {
+        auto &other = instrs[j];
+        int def_operand = other.info().def_operand;
+        std::size_t explicit_reads = reads.size();
+        for (int k = 0; k < int(other.operands.size()); k++) {
+            auto &op = other.operands[k];
+            if (op.text != temp || !(op.is_mem() || (op.is_reg() && k != def_operand)))
+                continue;
+            if (dest_changed)
+                return false;
+            reads.emplace_back(j, k);
+        }
+        // a syscall reads $v0, $a0 and $f12 without naming them, such reads can not be renamed
+        auto uses = other.uses();
+        if (reads.size() == explicit_reads && std::find(uses.begin(), uses.end(), temp) != uses.end())
+            return false;
+        temp_dies = defines(other, temp);
+        dest_changed = dest_changed || defines(other, dest);
+    }
+    if (!temp_dies && is_live_after(ctx, instrs.size() - 1, temp))
+        return false;
+
+    for (auto &[j, k]: reads)
+        instrs[j].operands[k].text = dest;
+    instr.operands[0] = next.operands[0];
+    ctx.erase(ctx.idx + 1);
+    return true;
+}
+
+// sw r, X ... sw r2, X with no load of X in between
+bool rule_dead_store(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (!instr.is_store() || !instr.operands[1].is_symbol())
+        return false;
+
+    auto &address = instr.operands[1];
+    auto &instrs = ctx.instrs();
+    for (std::size_t j = ctx.idx + 1; j < instrs.size(); j++) {
+        auto &other = instrs[j];
+        if (other.is_load() && other.operands[1] == address)
+            return false;
+        if (other.is_store() && other.operands[1] == address) {
+            ctx.erase(ctx.idx);
+            return true;
+        }
+    }
+    return false;
+}
+
+// mtc1 a, f1; cvt.s.w f1, f1 ... mtc1 a, f2; cvt.s.w f2, f2 -> mov.s f2, f1
+// mfc1 t, f ... mtc1 t, f -> nothing
+bool rule_duplicate_conversion(PeepholeContext &ctx) {
+    auto &instrs = ctx.instrs();
+    auto &instr = ctx.instr();
+    if (instr.opcode != "mtc1")
+        return false;
+    auto &int_reg = instr.operands[0].text;
+    auto &f_reg = instr.operands[1].text;
+
+    bool converts = ctx.has_next() && ctx.next().opcode == "cvt.s.w"
+                    && ctx.next().operands[0].text == f_reg && ctx.next().operands[1].text == f_reg;
+
+    for (std::size_t k = ctx.idx; k-- > 0;) {
+        auto &prev = instrs[k];
+        if (!converts && prev.opcode == "mfc1" && prev.operands[0].text == int_reg
+            && prev.operands[1].text == f_reg) {
+            ctx.erase(ctx.idx);
+            return true;
+        }
+        if (converts && prev.opcode == "mtc1" && prev.operands[0].text == int_reg
+            && k + 1 < ctx.idx && instrs[k + 1].opcode == "cvt.s.w"
+            && instrs[k + 1].operands[0] == prev.operands[1]) {
+            bool clobbered = false;
+            for (std::size_t m = k + 2; m < ctx.idx; m++) {
+                if (defines(instrs[m], int_reg) || defines(instrs[m], prev.operands[1].text))
+                    clobbered = true;
+            }
+            if (clobbered)
+                return false;
+            instr = ir::Instr("mov.s", {f_reg, prev.operands[1]});
+            ctx.erase(ctx.idx + 1);
+            return true;
+        }
+        if (defines(prev, int_reg) || defines(prev, f_reg))
+            return false;
+    }
+    return false;
+}
+
+// definition nobody reads
+bool rule_dead_definition(PeepholeContext &ctx) {
+    auto &instr = ctx.instr();
+    if (instr.has_side_effects())
+        return false;
+    auto defs = instr.defs();
+    if (defs.empty())
+        return false;
+    for (auto &def: defs) {
+        if (is_live_after(ctx, ctx.idx, def))
+            return false;
+    }
+    ctx.erase(ctx.idx);
+    return true;
+}
+
+const PeepholeRule rules[] = {
+    {"jump-to-next", rule_jump_to_next},
+    {"noop-arithmetic", rule_noop_arithmetic},
+    {"fold-imm-chain", rule_fold_imm_chain},
+    {"propagate-li", rule_propagate_li},
+    {"redundant-li", rule_redundant_li},
+    {"fold-address-offset", rule_fold_address_offset},
+    {"mul-to-shift", rule_mul_to_shift},
+    {"redundant-load", rule_redundant_load},
+    {"propagate-copy", rule_propagate_copy},
+    {"coalesce-copy", rule_coalesce_copy},
+    {"dead-store", rule_dead_store},
+    {"duplicate-conversion", rule_duplicate_conversion},
+    {"dead-definition", rule_dead_definition},
+};
+
+}
+
+void peephole(ir::Program &program, PassStats &stats) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        ir::Liveness liveness(program);
+
+        for (int b = 0; b < int(program.blocks.size()); b++) {
+            auto &instrs = program.blocks[b].instrs;
+            auto live_after = liveness.live_after(program, b);
+
+            for (std::size_t i = 0; i < instrs.size();) {
+                bool applied = false;
+                for (auto &rule: rules) {
+                    PeepholeContext ctx{program, b, i, live_after};
+                    std::size_t size_before = instrs.size();
+                    if (!rule.apply(ctx))
+                        continue;
+
+                    stats.add(rule.name, long(size_before - instrs.size()));
+                    live_after = liveness.live_after(program, b);
+                    applied = true;
+                    changed = true;
+                    break;
+                }
+                if (!applied)
+                    i++;
+                else if (i > 0)
+                    i--;
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Table driven local rewrites: redundant loads and stores, no-op arithmetic,
+/// constant chains, jumps to the next instruction and duplicate conversions.
+/// Reports instructions removed by every rule.
+void peephole(ir::Program &program, PassStats &stats);
+
+}
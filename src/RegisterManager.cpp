@@ -22,8 +22,8 @@ Reg::Reg(Reg &other) : reg_index(other.reg_index), type(other.type), compiler(nu
 };
 
 Reg::Reg(Reg &&other) noexcept
-: reg_index(other.reg_index), type(other.type), compiler(other.compiler),
-reserved_for_calc_result_alloc(other.reserved_for_calc_result_alloc){
+: reserved_for_calc_result_alloc(other.reserved_for_calc_result_alloc),
+reg_index(other.reg_index), type(other.type), compiler(other.compiler) {
     other.compiler = nullptr;
 }
 
@@ -52,6 +52,10 @@ Reg::operator bool() const {
 }
 
 Reg & Reg::operator=(Reg &&other) noexcept {
+    if (this == &other)
+        return *this;
+    // the register held so far is not referenced anymore
+    release();
     this->compiler = other.compiler;
     this->type = other.type;
     this->reg_index = other.reg_index;
@@ -75,43 +79,100 @@ bool Reg::is_reserved_for_calc_result_storing() const {
     return reserved_for_calc_result_alloc;
 }
 
-Reg::Reg(Type type, unsigned reg_index, Compiler *compiler): type {type}, reg_index{reg_index}, compiler{compiler} {}
+Reg::Reg(Type type, unsigned reg_index, Compiler *compiler): reg_index{reg_index}, type {type}, compiler{compiler} {}
 
 RegisterManager::RegisterManager(Compiler *compiler): compiler(compiler) {
     assert(compiler != nullptr);
     f_regs[12] = {StoringType::RESERVED};
 }
 
-int RegisterManager::try_preserve_value(Reg &reg, StoringType type, const std::string &symbol_name) {
+void RegisterManager::begin_operation() {
+    epoch++;
+}
+
+void RegisterManager::note_use(const Reg &reg) {
+    if (reg.get_type() != Reg::Type::T_REG && reg.get_type() != Reg::Type::F_REG)
+        return;
+    auto &storage = storage_of(reg);
+    storage.last_use = ++position;
+    storage.use_count++;
+    storage.use_epoch = epoch;
+}
+
+int RegisterManager::try_preserve_value(Reg &reg, StoringType type, Symbol symbol_name) {
     assert(reg && type != StoringType::NONE);
     reg.reserved_for_calc_result_alloc = false;
 
     if (reg.compiler == nullptr)
         return 0; // for copied Regs from symbolTable symbols
 
-    if (reg.get_type() == Reg::Type::T_REG) {
-        auto count = std::count_if(t_regs.begin(), t_regs.end(),
-            [](const RegStorage &r) { return r.storing_type == StoringType::NONE; });
+    if (reg.get_type() != Reg::Type::T_REG && reg.get_type() != Reg::Type::F_REG)
+        return -1;
+
+    // registers are handed back by spilling when pressure exceeds the register file,
+    // so there is no need to keep spare ones here
+    auto &storage = storage_of(reg);
+    storage.storing_type = type;
+    storage.var_id = symbol_name;
+    storage.use_epoch = epoch;
+    return 0;
+}
 
-        if (count > 2) {
-            t_regs[reg.reg_index].storing_type = type;
-            t_regs[reg.reg_index].var_id = symbol_name;
-            return 0;
+Reg RegisterManager::find_variable(Symbol symbol_name) {
+    auto lambda = [&](auto &regs, Reg::Type reg_type) -> Reg {
+        for (unsigned i = 0; i < regs.size(); i++) {
+            if (regs[i].storing_type == StoringType::VARIABLE && regs[i].var_id == symbol_name) {
+                Reg reg(reg_type, i, nullptr);
+                note_use(reg);
+                return reg;
+            }
         }
-        return -1;
-    }
-    if (reg.get_type() == Reg::Type::F_REG) {
-        auto count = std::count_if(f_regs.begin(), f_regs.end(),
-            [](const RegStorage &r) { return r.storing_type == StoringType::NONE; });
-
-        if (count > 2) {
-            f_regs[reg.reg_index].storing_type = type;
-            f_regs[reg.reg_index].var_id = symbol_name;
-            return 0;
+        return {};
+    };
+    Reg reg = lambda(t_regs, Reg::Type::T_REG);
+    if (reg)
+        return reg;
+    return lambda(f_regs, Reg::Type::F_REG);
+}
+
+void RegisterManager::bind_variable(Reg &reg, Symbol symbol_name) {
+    if (reg.get_type() != Reg::Type::T_REG && reg.get_type() != Reg::Type::F_REG)
+        return;
+
+    // the previous copy of the variable is outdated
+    auto drop_copies = [&](auto &regs) {
+        for (auto &storage: regs) {
+            if (storage.storing_type == StoringType::VARIABLE && storage.var_id == symbol_name)
+                storage.reset();
         }
-        return -1;
+    };
+    drop_copies(t_regs);
+    drop_copies(f_regs);
+
+    auto &storage = storage_of(reg);
+    if (storage.storing_type == StoringType::CALC_RESULT) {
+        // ownership of the calculation result moves to the variable
+        if (!storage.var_id.empty())
+            compiler->symbolTable.at(storage.var_id).occupied_reg.reset();
+    } else if (storage.storing_type != StoringType::TEMP || reg.compiler == nullptr) {
+        return; // register not owned by the caller
+    }
+
+    storage.storing_type = StoringType::VARIABLE;
+    storage.var_id = symbol_name;
+    storage.use_epoch = epoch;
+    reg.compiler = nullptr;
+}
+
+void RegisterManager::invalidate_variables() {
+    for (auto &storage: t_regs) {
+        if (storage.storing_type == StoringType::VARIABLE)
+            storage.reset();
+    }
+    for (auto &storage: f_regs) {
+        if (storage.storing_type == StoringType::VARIABLE)
+            storage.reset();
     }
-    return -1;
 }
 
 void RegisterManager::tmp_cleanup() {
@@ -145,13 +206,13 @@ void RegisterManager::release_calc_results() {
     }
 }
 
-void RegisterManager::gen_dump_calc_results_to_memory(std::ostream &text_region) {
+void RegisterManager::gen_dump_calc_results_to_memory() {
     auto lambda = [&](RegStorage &reg_storage, const std::string& postfix) {
         if (reg_storage.storing_type == StoringType::CALC_RESULT) {
             if (!reg_storage.var_id.empty()) {
                 auto& sym = compiler->symbolTable.at(reg_storage.var_id);
                 Reg *reg_ptr = &sym.occupied_reg;
-                text_region << "s" << postfix << " " << *reg_ptr << ", " << reg_storage.var_id << std::endl;
+                compiler->program.emit("s" + postfix, {*reg_ptr, reg_storage.var_id});
                 reg_ptr->reset();
                 sym.tmp_in_data_region = true;
                 reg_storage.reset();
@@ -186,34 +247,97 @@ Reg RegisterManager::get_free_register(Reg::Type type, StoringType target_purpos
         if (target_purpose == StoringType::TEMP) {
             for (unsigned i = 0; i < regs.size(); i++) {
                 if (regs[i].storing_type == StoringType::NONE) {
-                    regs[i].storing_type = StoringType::TEMP;
+                    claim(regs, i);
                     return {reg_type, i, compiler};
                 }
             }
         } else {
             for (unsigned i = regs.size(); i-- > 0;) {
                 if (regs[i].storing_type == StoringType::NONE) {
-                    regs[i].storing_type = StoringType::TEMP;
+                    claim(regs, i);
                     Reg r = {reg_type, i, compiler};
                     if (target_purpose == StoringType::CALC_RESULT)
                         r.reserved_for_calc_result_alloc = true;
-                    return std::move(r);
+                    return r;
                 }
             }
         }
         return void_reg;
     };
 
-    if (type == Reg::Type::T_REG)
-        return get_free_reg(t_regs, type);
+    do {
+        Reg reg = type == Reg::Type::T_REG ? get_free_reg(t_regs, type) : get_free_reg(f_regs, type);
+        if (reg)
+            return reg;
+    } while (spill_one(type));
+
+    return void_reg;
+}
+
+template<std::size_t N>
+void RegisterManager::claim(std::array<RegStorage, N> &regs, unsigned idx) {
+    auto &storage = regs[idx];
+    storage.storing_type = StoringType::TEMP;
+    storage.last_use = ++position;
+    storage.use_count = 0;
+    storage.use_epoch = epoch;
+    storage.loop_depth = compiler->loop_depth;
+}
 
+bool RegisterManager::spill_one(Reg::Type type) {
+    if (type == Reg::Type::T_REG)
+        return spill_one(t_regs, type);
     if (type == Reg::Type::F_REG)
-        return get_free_reg(f_regs, type);
+        return spill_one(f_regs, type);
+    return false;
+}
 
-    return void_reg;
+template<std::size_t N>
+bool RegisterManager::spill_one(std::array<RegStorage, N> &regs, Reg::Type type) {
+    // Spill cost of a register: the uses of its value weighted by loop nesting. Cached variables are
+    // already in memory so they are always dropped before any calculation result.
+    auto spill_cost = [](const RegStorage &storage) {
+        unsigned weight = 1;
+        for (int i = 0; i < storage.loop_depth && i < 3; i++)
+            weight *= 10;
+        unsigned cost = (storage.use_count + 1) * weight;
+        return storage.storing_type == StoringType::VARIABLE ? cost : cost + 1000000;
+    };
+
+    RegStorage *victim = nullptr;
+    for (auto &storage: regs) {
+        if (storage.storing_type != StoringType::VARIABLE && storage.storing_type != StoringType::CALC_RESULT)
+            continue;
+        if (storage.var_id.empty() || storage.use_epoch == epoch)
+            continue;
+        if (victim == nullptr || spill_cost(storage) < spill_cost(*victim)
+            || (spill_cost(storage) == spill_cost(*victim) && storage.last_use < victim->last_use)) {
+            victim = &storage;
+        }
+    }
+
+    if (victim == nullptr)
+        return false;
+
+    if (victim->storing_type == StoringType::CALC_RESULT) {
+        auto &sym = compiler->symbolTable.at(victim->var_id);
+        compiler->program.emit(type == Reg::Type::F_REG ? "s.s" : "sw", {sym.occupied_reg, victim->var_id});
+        sym.occupied_reg.reset();
+        sym.tmp_in_data_region = true;
+    }
+    victim->reset();
+    return true;
+}
+
+RegisterManager::RegStorage &RegisterManager::storage_of(const Reg &reg) {
+    assert(reg.get_type() == Reg::Type::T_REG || reg.get_type() == Reg::Type::F_REG);
+    if (reg.get_type() == Reg::Type::T_REG)
+        return t_regs[reg.reg_index];
+    return f_regs[reg.reg_index];
 }
 
 void RegisterManager::RegStorage::reset() {
     storing_type = StoringType::NONE;
-    var_id.clear();
+    var_id = {};
+    use_count = 0;
 }
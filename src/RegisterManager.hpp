@@ -2,6 +2,9 @@
 #include <cassert>
 #include <string>
 #include <array>
+#include <ostream>
+
+#include "Interner.hpp"
 
 class Compiler;
 class RegisterManager;
@@ -62,6 +65,10 @@ inline std::ostream &operator <<(std::ostream &os, const Reg &reg) {
     return os << reg_name;
 }
 
+/// @brief Greedy allocation while the code is emitted in one pass, not a linear scan: live ranges
+/// are not known ahead. Registers are handed out on request. When none is free, one is taken
+/// from a cached variable copy or a calculation result spilled to its data region slot, picked
+/// by loop-weighted use count. Variable copies stay cached across statements up to the next label.
 class RegisterManager {
 public:
     static constexpr int T_REG_COUNT = 8;
@@ -79,13 +86,28 @@ public:
 
     explicit RegisterManager(Compiler *compiler);
 
-    [[nodiscard]] int try_preserve_value(Reg &reg, StoringType type, const std::string &symbol_name);
+    /// @brief Starts a new code generation operation. Registers used during the current
+    /// operation are never picked as spill candidates.
+    void begin_operation();
+
+    void note_use(const Reg &reg);
+
+    [[nodiscard]] int try_preserve_value(Reg &reg, StoringType type, Symbol symbol_name);
+
+    /// @return register holding up-to-date copy of the variable or an invalid Reg
+    Reg find_variable(Symbol symbol_name);
+
+    /// @brief Marks register as holding a copy of the variable that was just stored to memory
+    void bind_variable(Reg &reg, Symbol symbol_name);
+
+    /// @brief Drops all cached variable copies. Has to be called on every label (join point).
+    void invalidate_variables();
 
     void tmp_cleanup();
 
     void release_calc_results();
 
-    void gen_dump_calc_results_to_memory(std::ostream &text_region);
+    void gen_dump_calc_results_to_memory();
 
     void release_register(Reg::Type type, int idx);
 
@@ -94,12 +116,34 @@ public:
 private:
     struct RegStorage {
         StoringType storing_type = StoringType::NONE;
-        std::string var_id{};
+        Symbol var_id{};
+
+        // use bookkeeping for the spill heuristic
+        unsigned last_use = 0;
+        unsigned use_count = 0;
+        unsigned use_epoch = 0;
+        int loop_depth = 0;
 
         void reset();
     };
 
+    /// @brief Hands out a free register as a temporary, resetting its use bookkeeping
+    template<std::size_t N>
+    void claim(std::array<RegStorage, N> &regs, unsigned idx);
+
+    /// @brief Frees one register of given type by dropping a cached variable or spilling
+    /// a calculation result to its data region slot.
+    /// @return false if every register is in use by the current operation
+    bool spill_one(Reg::Type type);
+
+    template<std::size_t N>
+    bool spill_one(std::array<RegStorage, N> &regs, Reg::Type type);
+
+    RegStorage &storage_of(const Reg &reg);
+
     std::array<RegStorage, T_REG_COUNT> t_regs{};
     std::array<RegStorage, F_REG_COUNT> f_regs{};
     Compiler *compiler = nullptr;
+    unsigned position = 0;
+    unsigned epoch = 0;
 };
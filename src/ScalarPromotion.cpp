@@ -0,0 +1,135 @@
+#include "ScalarPromotion.hpp"
+#include "LoopInfo.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace passes {
+
+namespace {
+
+struct ScalarUse {
+    int accesses = 0;
+    bool is_float = false;
+    bool stored = false;
+    bool promotable = true;
+};
+
+bool is_outermost(const std::vector<ir::Loop> &loops, const ir::Loop &loop) {
+    return std::none_of(loops.begin(), loops.end(), [&](const ir::Loop &other) {
+        return other.blocks.size() > loop.blocks.size() && other.contains(loop.header);
+    });
+}
+
+/// @return true if the write-backs can go at the start of the exit blocks, every exit block is
+/// entered only from the loop. The bounds check failure handler ends the program and needs none.
+bool has_private_exits(const ir::Program &program, const ir::Loop &loop,
+                       const std::vector<std::vector<int>> &preds) {
+    for (int exit: loop.exits) {
+        if (program.blocks[exit].label == ir::BOUNDS_FAIL_LABEL)
+            continue;
+        for (int pred: preds[exit]) {
+            if (!loop.contains(pred))
+                return false;
+        }
+    }
+    return true;
+}
+
+/// @return the scalar symbols the loop reads and writes only by name with lw/sw or l.s/s.s
+std::map<std::string, ScalarUse> scalar_uses(const ir::Program &program, const ir::Loop &loop,
+                                             const std::vector<std::string> &address_taken) {
+    std::map<std::string, ScalarUse> uses;
+    for (int b: loop.blocks) {
+        for (auto &instr: program.blocks[b].instrs) {
+            if ((!instr.is_load() && !instr.is_store()) || !instr.operands[1].is_symbol())
+                continue;
+            const std::string &text = instr.operands[1].text;
+            auto plus = text.find('+');
+            auto &use = uses[text.substr(0, plus)];
+            bool is_float = ir::is_float_access(instr.opcode);
+            if (plus != std::string::npos || (use.accesses > 0 && use.is_float != is_float))
+                use.promotable = false;
+            use.accesses++;
+            use.is_float = is_float;
+            use.stored |= instr.is_store();
+        }
+    }
+    for (auto &symbol: address_taken) {
+        auto it = uses.find(symbol);
+        if (it != uses.end())
+            it->second.promotable = false;
+    }
+    return uses;
+}
+
+void promote(ir::Program &program, const ir::Loop &loop, const std::string &symbol, const ScalarUse &use,
+             const std::string &reg) {
+    const char *move = use.is_float ? "mov.s" : "move";
+    for (int b: loop.blocks) {
+        for (auto &instr: program.blocks[b].instrs) {
+            if ((!instr.is_load() && !instr.is_store()) || instr.operands[1].text != symbol)
+                continue;
+            if (instr.is_load())
+                instr = ir::Instr(move, {instr.operands[0], reg});
+            else
+                instr = ir::Instr(move, {reg, instr.operands[0]});
+        }
+    }
+
+    auto &preheader = program.blocks[loop.preheader].instrs;
+    auto at = preheader.end();
+    if (!preheader.empty() && preheader.back().is_terminator())
+        at--;
+    preheader.insert(at, ir::Instr(use.is_float ? "l.s" : "lw", {reg, symbol}));
+
+    if (!use.stored)
+        return;
+    for (int exit: loop.exits) {
+        auto &bb = program.blocks[exit];
+        if (bb.label != ir::BOUNDS_FAIL_LABEL)
+            bb.instrs.insert(bb.instrs.begin(), ir::Instr(use.is_float ? "s.s" : "sw", {reg, symbol}));
+    }
+}
+
+/// @return true if a scalar was promoted
+bool promote_one(ir::Program &program, PassStats &stats) {
+    ir::LoopInfo loop_info(program);
+    ir::Liveness liveness(program);
+    auto preds = program.predecessors();
+    auto address_taken = ir::address_taken_symbols(program);
+    for (auto &loop: loop_info.loops()) {
+        if (loop.preheader < 0 || !is_outermost(loop_info.loops(), loop) || !has_private_exits(program, loop, preds))
+            continue;
+
+        // the most accessed first while registers last
+        std::vector<std::pair<std::string, ScalarUse>> candidates;
+        for (auto &[symbol, use]: scalar_uses(program, loop, address_taken)) {
+            if (use.promotable)
+                candidates.emplace_back(symbol, use);
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [](auto &lhs, auto &rhs) {
+            return lhs.second.accesses > rhs.second.accesses;
+        });
+        for (auto &[symbol, use]: candidates) {
+            auto reg = ir::find_unused_register(program, loop, liveness.live_in(loop.header),
+                                                use.is_float ? "$f0" : "$t0");
+            if (reg.empty())
+                continue;
+            promote(program, loop, symbol, use, reg);
+            stats.add(use.stored ? "variables promoted" : "read-only variables promoted", 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+void promote_loop_scalars(ir::Program &program, PassStats &stats) {
+    // a promoted symbol is no longer accessed inside its loop nest
+    while (promote_one(program, stats)) {
+    }
+}
+
+}
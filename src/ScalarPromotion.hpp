@@ -0,0 +1,13 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Keeps loop counters, bounds and the other scalar variables of an outermost loop nest
+/// in registers for the whole nest: loaded once before it, copied instead of loaded and stored
+/// inside it and written back where it is left. Write-backs nothing reads are left to the dead
+/// store elimination.
+void promote_loop_scalars(ir::Program &program, PassStats &stats);
+
+}
@@ -0,0 +1,296 @@
+#include "StrengthReduction.hpp"
+#include "LoopInfo.hpp"
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <set>
+
+namespace passes {
+
+namespace {
+
+/// @brief coef * iv + sum(bases) + constant, bases are registers not written in the loop
+struct Affine {
+    int64_t coef = 0;
+    std::vector<std::string> bases;
+    int64_t constant = 0;
+
+    bool operator==(const Affine &other) const {
+        return coef == other.coef && bases == other.bases && constant == other.constant;
+    }
+};
+
+using MaybeAffine = std::optional<Affine>;
+
+bool fits_i32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+MaybeAffine add(const MaybeAffine &a, const MaybeAffine &b) {
+    if (!a || !b)
+        return std::nullopt;
+    Affine sum{a->coef + b->coef, a->bases, a->constant + b->constant};
+    sum.bases.insert(sum.bases.end(), b->bases.begin(), b->bases.end());
+    std::sort(sum.bases.begin(), sum.bases.end());
+    if (!fits_i32(sum.coef) || !fits_i32(sum.constant))
+        return std::nullopt;
+    return sum;
+}
+
+MaybeAffine scale(const MaybeAffine &a, int64_t factor) {
+    if (!a || !a->bases.empty())
+        return std::nullopt;
+    Affine scaled{a->coef * factor, {}, a->constant * factor};
+    if (!fits_i32(scaled.coef) || !fits_i32(scaled.constant))
+        return std::nullopt;
+    return scaled;
+}
+
+MaybeAffine constant_of(const MaybeAffine &a) {
+    if (a && a->coef == 0 && a->bases.empty())
+        return a;
+    return std::nullopt;
+}
+
+/// @brief Symbolic evaluation of integer registers in terms of one counter variable
+class AffineEvaluator {
+public:
+    AffineEvaluator(std::string iv, const ir::RegSet &loop_defs) : iv(std::move(iv)), loop_defs(loop_defs) {}
+
+    void reset() { values.clear(); }
+
+    MaybeAffine value_of(const ir::Operand &op) const {
+        if (op.is_imm())
+            return Affine{0, {}, std::stoll(op.text)};
+        if (!op.is_reg())
+            return std::nullopt;
+        auto it = values.find(op.text);
+        if (it != values.end())
+            return it->second;
+        int bit = ir::reg_bit(op.text);
+        if (bit >= 0 && !loop_defs.test(bit) && op.text[1] != 'f')
+            return Affine{0, {op.text}, 0};
+        return std::nullopt;
+    }
+
+    void step(const ir::Instr &instr) {
+        auto &ops = instr.operands;
+        auto defs = instr.defs();
+        MaybeAffine result;
+
+        const auto &opcode = instr.opcode;
+        if (opcode == "lw" && ops[1].is_symbol() && ops[1].text == iv) {
+            result = Affine{1, {}, 0};
+        } else if (opcode == "li") {
+            result = value_of(ops[1]);
+        } else if (opcode == "move") {
+            result = value_of(ops[1]);
+        } else if (ir::additive_sign(opcode) > 0) {
+            result = add(value_of(ops[1]), value_of(ops[2]));
+        } else if (ir::additive_sign(opcode) < 0) {
+            auto rhs = constant_of(value_of(ops[2]));
+            if (rhs)
+                result = add(value_of(ops[1]), Affine{0, {}, -rhs->constant});
+        } else if (opcode == "sll") {
+            auto shift = constant_of(value_of(ops[2]));
+            if (shift && shift->constant >= 0 && shift->constant < 31)
+                result = scale(value_of(ops[1]), int64_t(1) << shift->constant);
+        } else if (opcode == "mul") {
+            auto lhs = value_of(ops[1]);
+            auto rhs = value_of(ops[2]);
+            if (constant_of(rhs))
+                result = scale(lhs, rhs->constant);
+            else if (constant_of(lhs))
+                result = scale(rhs, lhs->constant);
+        }
+
+        for (auto &def: defs)
+            values.erase(def);
+        if (result && defs.size() == 1)
+            values[defs[0]] = result.value();
+
+        // values read from the counter before the store are stale afterwards
+        if (instr.is_store() && ops[1].is_symbol() && ops[1].text == iv) {
+            for (auto it = values.begin(); it != values.end();) {
+                if (it->second.coef != 0)
+                    it = values.erase(it);
+                else
+                    ++it;
+            }
+        }
+    }
+
+private:
+    std::string iv;
+    const ir::RegSet &loop_defs;
+    std::map<std::string, Affine> values;
+};
+
+struct Access {
+    int block;
+    std::size_t idx;
+    Affine address;
+};
+
+/// @brief Collects the arithmetic in the block before position idx computing reg
+void collect_chain(const std::vector<ir::Instr> &instrs, std::size_t idx, const std::string &reg,
+                   std::set<std::size_t> &chain) {
+    std::vector<std::string> wanted = {reg};
+    for (std::size_t i = idx; i-- > 0 && !wanted.empty();) {
+        auto defs = instrs[i].defs();
+        if (defs.size() != 1)
+            continue;
+        auto found = std::find(wanted.begin(), wanted.end(), defs[0]);
+        if (found == wanted.end())
+            continue;
+        wanted.erase(found);
+        if (instrs[i].info().kind != ir::OpInfo::Kind::ARITHMETIC)
+            continue;
+        chain.insert(i);
+        for (auto &use: instrs[i].uses())
+            wanted.push_back(use);
+    }
+}
+
+/// @brief Removes the instructions of chain nothing reads anymore. Their add instructions may trap
+/// on overflow, yet so do the increments of the pointer replacing them: the loop still stops
+/// with an error where the address would have overflowed.
+void remove_dead_chain(std::vector<ir::Instr> &instrs, const std::set<std::size_t> &chain, ir::RegSet live) {
+    for (std::size_t i = instrs.size(); i-- > 0;) {
+        auto defs = instrs[i].defs();
+        bool dead = chain.count(i) != 0;
+        for (auto &def: defs) {
+            int bit = ir::reg_bit(def);
+            dead &= bit >= 0 && !live.test(bit);
+        }
+        if (dead) {
+            instrs.erase(instrs.begin() + long(i));
+            continue;
+        }
+        live &= ~ir::reg_set(defs);
+        live |= ir::reg_set(instrs[i].uses());
+    }
+}
+
+/// @brief Replaces accesses sharing one affine address form with a bumped pointer
+/// @return true if the program changed
+bool reduce_one(ir::Program &program, const ir::Loop &loop, const ir::Liveness &liveness,
+                const std::vector<std::string> &address_taken, PassStats &stats) {
+    ir::RegSet loop_defs;
+    std::map<std::string, int> store_counts;
+    for (int b: loop.blocks) {
+        for (auto &instr: program.blocks[b].instrs) {
+            loop_defs |= ir::reg_set(instr.defs());
+            if (instr.is_store() && instr.operands[1].is_symbol())
+                store_counts[instr.operands[1].text]++;
+        }
+    }
+
+    for (auto &[iv, count]: store_counts) {
+        if (count != 1 || std::find(address_taken.begin(), address_taken.end(), iv) != address_taken.end())
+            continue;
+
+        AffineEvaluator evaluator(iv, loop_defs);
+        std::optional<int64_t> iv_step;
+        std::pair<int, std::size_t> increment;
+        std::vector<Access> accesses;
+
+        for (int b: loop.blocks) {
+            evaluator.reset();
+            auto &instrs = program.blocks[b].instrs;
+            for (std::size_t i = 0; i < instrs.size(); i++) {
+                auto &instr = instrs[i];
+                if (instr.is_store() && instr.operands[1].is_symbol() && instr.operands[1].text == iv) {
+                    auto stored = evaluator.value_of(instr.operands[0]);
+                    if (stored && stored->coef == 1 && stored->bases.empty() && stored->constant != 0)
+                        iv_step = stored->constant;
+                    increment = {b, i};
+                }
+                if ((instr.is_load() || instr.is_store()) && instr.operands[1].is_mem()) {
+                    auto address = evaluator.value_of(ir::Operand(instr.operands[1].text));
+                    if (address && address->coef != 0)
+                        accesses.push_back({b, i, address.value()});
+                }
+                evaluator.step(instr);
+            }
+        }
+        if (!iv_step || accesses.empty())
+            continue;
+
+        auto &form = accesses[0].address;
+        int64_t stride = form.coef * iv_step.value();
+        if (!fits_i32(stride))
+            continue;
+        auto pointer = ir::find_unused_register(program, loop, liveness.live_in(loop.header), "$t0");
+        if (pointer.empty()) {
+            stats.add("out of registers", 1);
+            return false;
+        }
+
+        std::map<int, std::set<std::size_t>> chains; // block -> address computations replaced
+        for (auto &access: accesses) {
+            if (access.address == form) {
+                auto &instrs = program.blocks[access.block].instrs;
+                collect_chain(instrs, access.idx, instrs[access.idx].operands[1].text, chains[access.block]);
+                instrs[access.idx].operands[1] = ir::Operand::mem(pointer);
+                stats.add("accesses rewritten", 1);
+            }
+        }
+
+        // pointer = coef * iv + bases + constant on entry, then follows every increment
+        auto &increment_block = program.blocks[increment.first].instrs;
+        increment_block.insert(increment_block.begin() + long(increment.second) + 1,
+                               ir::Instr("addi", {pointer, pointer, int(stride)}));
+        if (chains.count(increment.first)) {
+            std::set<std::size_t> shifted;
+            for (auto i: chains[increment.first])
+                shifted.insert(i > increment.second ? i + 1 : i);
+            chains[increment.first] = shifted;
+        }
+        for (auto &[b, chain]: chains)
+            remove_dead_chain(program.blocks[b].instrs, chain, liveness.live_out(b));
+
+        std::vector<ir::Instr> init = {ir::Instr("lw", {pointer, iv})};
+        if (form.coef != 1)
+            init.emplace_back("mul", std::vector<ir::Operand>{pointer, pointer, int(form.coef)});
+        for (auto &base: form.bases)
+            init.emplace_back("add", std::vector<ir::Operand>{pointer, pointer, base});
+        if (form.constant != 0)
+            init.emplace_back("addi", std::vector<ir::Operand>{pointer, pointer, int(form.constant)});
+
+        auto &preheader = program.blocks[loop.preheader].instrs;
+        auto insert_pos = preheader.end() - (!preheader.empty() && preheader.back().is_terminator() ? 1 : 0);
+        preheader.insert(insert_pos, init.begin(), init.end());
+        stats.add("pointers", 1);
+        return true;
+    }
+    return false;
+}
+
+}
+
+void strength_reduce_ivs(ir::Program &program, PassStats &stats) {
+    std::vector<std::string> address_taken;
+    for (auto &bb: program.blocks) {
+        for (auto &instr: bb.instrs) {
+            if (instr.opcode == "la")
+                address_taken.push_back(instr.operands[1].text.substr(0, instr.operands[1].text.find('+')));
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        ir::LoopInfo loop_info(program);
+        ir::Liveness liveness(program);
+        for (auto &loop: loop_info.loops()) {
+            if (loop.preheader >= 0 && reduce_one(program, loop, liveness, address_taken, stats)) {
+                changed = true;
+                break;
+            }
+        }
+    }
+}
+
+}
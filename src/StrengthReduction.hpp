@@ -0,0 +1,11 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Induction variable strength reduction: array element addresses that are affine
+/// in a loop counter are kept in a pointer register bumped by the stride on every increment.
+void strength_reduce_ivs(ir::Program &program, PassStats &stats);
+
+}
@@ -0,0 +1,192 @@
+#include "TempSlots.hpp"
+#include "HashMap.hpp"
+
+#include <algorithm>
+
+namespace passes {
+
+namespace {
+
+bool is_temporary(const ir::Operand &operand) {
+    return operand.is_symbol() && operand.text.rfind("__tmp", 0) == 0;
+}
+
+bool is_slot_access(const ir::Instr &instr) {
+    return (instr.is_load() || instr.is_store()) && instr.operands.size() == 2 && instr.operands[1].is_symbol();
+}
+
+/// @brief Sorted set of temporary numbers, blocks touch only a few temporaries
+using TempSet = std::vector<int>;
+
+void insert(TempSet &set, int temp) {
+    auto it = std::lower_bound(set.begin(), set.end(), temp);
+    if (it == set.end() || *it != temp)
+        set.insert(it, temp);
+}
+
+void erase(TempSet &set, int temp) {
+    auto it = std::lower_bound(set.begin(), set.end(), temp);
+    if (it != set.end() && *it == temp)
+        set.erase(it);
+}
+
+struct Temporaries {
+    HashMap<std::string, int> index;
+    std::vector<std::string> names; // in order of first appearance
+    std::vector<bool> pinned; // referred to otherwise than by a plain load or store, keeps its own slot
+};
+
+Temporaries collect_temporaries(const ir::Program &program) {
+    Temporaries temps;
+    for (auto &bb: program.blocks) {
+        for (auto &instr: bb.instrs) {
+            for (std::size_t i = 0; i < instr.operands.size(); i++) {
+                auto &op = instr.operands[i];
+                if (!is_temporary(op))
+                    continue;
+                auto found = temps.index.find(op.text);
+                int temp;
+                if (found.has_value()) {
+                    temp = *found.value();
+                } else {
+                    temp = int(temps.names.size());
+                    temps.index[op.text] = temp;
+                    temps.names.push_back(op.text);
+                    temps.pinned.push_back(false);
+                }
+                if (!is_slot_access(instr) || i != 1)
+                    temps.pinned[temp] = true;
+            }
+        }
+    }
+    return temps;
+}
+
+/// @return temporary accessed by the instruction or -1
+int accessed_temporary(const Temporaries &temps, const ir::Instr &instr) {
+    if (!is_slot_access(instr) || !is_temporary(instr.operands[1]))
+        return -1;
+    return *temps.index.find(instr.operands[1].text).value();
+}
+
+/// @brief Temporaries whose stored value may still be loaded at the end of every block
+std::vector<TempSet> live_out(const ir::Program &program, const Temporaries &temps) {
+    int block_count = int(program.blocks.size());
+    std::vector<TempSet> upward_exposed(block_count), stored(block_count);
+    for (int b = 0; b < block_count; b++) {
+        auto &instrs = program.blocks[b].instrs;
+        for (auto it = instrs.rbegin(); it != instrs.rend(); ++it) {
+            int temp = accessed_temporary(temps, *it);
+            if (temp < 0)
+                continue;
+            if (it->is_store()) {
+                erase(upward_exposed[b], temp);
+                insert(stored[b], temp);
+            } else {
+                insert(upward_exposed[b], temp);
+            }
+        }
+    }
+
+    std::vector<std::vector<int>> succs(block_count);
+    for (int b = 0; b < block_count; b++)
+        succs[b] = program.successors(b);
+
+    std::vector<TempSet> out(block_count), in = upward_exposed;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = block_count - 1; b >= 0; b--) {
+            TempSet new_out;
+            for (int succ: succs[b]) {
+                TempSet merged;
+                std::set_union(new_out.begin(), new_out.end(), in[succ].begin(), in[succ].end(),
+                               std::back_inserter(merged));
+                new_out = std::move(merged);
+            }
+            if (new_out == out[b])
+                continue;
+            out[b] = std::move(new_out);
+
+            TempSet passing, new_in;
+            std::set_difference(out[b].begin(), out[b].end(), stored[b].begin(), stored[b].end(),
+                                std::back_inserter(passing));
+            std::set_union(passing.begin(), passing.end(), upward_exposed[b].begin(), upward_exposed[b].end(),
+                           std::back_inserter(new_in));
+            in[b] = std::move(new_in);
+            changed = true;
+        }
+    }
+    return out;
+}
+
+}
+
+void pack_temporary_slots(ir::Program &program, PassStats &stats) {
+    auto temps = collect_temporaries(program);
+    int count = int(temps.names.size());
+    if (count < 2)
+        return;
+
+    // A store clobbers the slot, so it interferes with every temporary live across it
+    std::vector<TempSet> interference(count);
+    auto out = live_out(program, temps);
+    for (int b = 0; b < int(program.blocks.size()); b++) {
+        TempSet live = out[b];
+        auto &instrs = program.blocks[b].instrs;
+        for (auto it = instrs.rbegin(); it != instrs.rend(); ++it) {
+            int temp = accessed_temporary(temps, *it);
+            if (temp < 0)
+                continue;
+            if (!it->is_store()) {
+                insert(live, temp);
+                continue;
+            }
+            erase(live, temp);
+            for (int other: live) {
+                insert(interference[temp], other);
+                insert(interference[other], temp);
+            }
+        }
+    }
+
+    // Greedy colouring in order of first appearance, pinned temporaries get a colour of their own
+    std::vector<int> colour(count, -1);
+    std::vector<int> representative; // temporary whose name the slot keeps
+    std::vector<int> taken_by; // colour -> last temporary which found it taken
+    for (int temp = 0; temp < count; temp++) {
+        if (!temps.pinned[temp]) {
+            for (int other: interference[temp]) {
+                if (colour[other] >= 0)
+                    taken_by[colour[other]] = temp;
+            }
+            for (int c = 0; c < int(representative.size()); c++) {
+                if (taken_by[c] != temp && !temps.pinned[representative[c]]) {
+                    colour[temp] = c;
+                    break;
+                }
+            }
+        }
+        if (colour[temp] < 0) {
+            colour[temp] = int(representative.size());
+            representative.push_back(temp);
+            taken_by.push_back(-1);
+        }
+    }
+
+    long renamed = 0;
+    for (auto &bb: program.blocks) {
+        for (auto &instr: bb.instrs) {
+            int temp = accessed_temporary(temps, instr);
+            if (temp < 0 || representative[colour[temp]] == temp)
+                continue;
+            instr.operands[1].text = temps.names[representative[colour[temp]]];
+            renamed++;
+        }
+    }
+    stats.add("temporaries", count);
+    stats.add("slots", long(representative.size()));
+    stats.add("renamed accesses", renamed);
+}
+
+}
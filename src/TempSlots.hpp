@@ -0,0 +1,12 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Gives spilled temporaries (__tmp data symbols) with disjoint lifetimes a shared slot.
+/// Lifetimes come from liveness of the stored values, slots are assigned by colouring the
+/// interference graph like registers, every temporary is renamed to its slot representative.
+void pack_temporary_slots(ir::Program &program, PassStats &stats);
+
+}
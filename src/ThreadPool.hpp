@@ -0,0 +1,37 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/// @brief Fixed number of worker threads executing submitted tasks in FIFO order
+class ThreadPool {
+public:
+    /// @param thread_count 0 selects the number of hardware threads
+    explicit ThreadPool(unsigned thread_count = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// @brief Tasks must not throw, report failures through captured state instead
+    void submit(std::function<void()> task);
+
+    /// @brief Blocks until every submitted task finished
+    void wait();
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable task_available;
+    std::condition_variable all_done;
+    std::size_t running = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,205 @@
+#include "Trace.hpp"
+#include "Compiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace {
+
+std::atomic<trace::Recorder *> active_recorder{nullptr};
+
+std::atomic<int> thread_counter{0};
+thread_local int thread_number = 0;
+
+std::string json_string(std::string_view text) {
+    std::string json = "\"";
+    for (char c: text) {
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof escaped, "\\u%04x", c);
+            json += escaped;
+        } else {
+            json += c;
+        }
+    }
+    return json + '"';
+}
+
+void append_number(std::string &args, const char *key, uint64_t value) {
+    if (!args.empty())
+        args += ", ";
+    args += '"';
+    args += key;
+    args += "\": ";
+    args += std::to_string(value);
+}
+
+std::string heap_args(const memstats::Counters &heap) {
+    std::string args;
+    append_number(args, "allocations", heap.allocations);
+    append_number(args, "allocated_bytes", heap.allocated_bytes);
+    return args;
+}
+
+std::string counter_args(const trace::Counters &counters) {
+    std::string args;
+    append_number(args, "tokens", counters.tokens);
+    append_number(args, "reductions", counters.reductions);
+    append_number(args, "instructions", counters.instructions);
+    append_number(args, "symbol_lookups", counters.symbol_lookups);
+    return args;
+}
+
+/// Rows of a thread in the trace, tracks of one thread are numbered consecutively
+constexpr int TRACKS_PER_THREAD = 2;
+
+}
+
+namespace trace {
+
+Recorder::Recorder() : start(std::chrono::steady_clock::now()) {}
+
+double Recorder::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+int Recorder::thread_id() {
+    if (thread_number == 0)
+        thread_number = ++thread_counter;
+    return thread_number;
+}
+
+void Recorder::complete(std::string_view name, double time, double duration, std::string args, int track) {
+    int tid = thread_id() * TRACKS_PER_THREAD + track;
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back({'X', std::string(name), tid, time, duration, std::move(args)});
+    if (std::find(tids.begin(), tids.end(), tid) == tids.end())
+        tids.push_back(tid);
+}
+
+void Recorder::counter(std::string_view name, double time, std::string args) {
+    int tid = thread_id() * TRACKS_PER_THREAD;
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back({'C', std::string(name), tid, time, 0, std::move(args)});
+}
+
+void Recorder::write(std::ostream &ostream) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    ostream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+    bool first = true;
+    auto separator = [&] {
+        if (!first)
+            ostream << "," << std::endl;
+        first = false;
+    };
+
+    for (int tid: tids) {
+        separator();
+        std::string name = "thread " + std::to_string(tid / TRACKS_PER_THREAD);
+        if (tid % TRACKS_PER_THREAD != 0)
+            name += " parse phases";
+        ostream << "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": " << tid
+                << ", \"args\": {\"name\": " << json_string(name) << "}}";
+    }
+
+    char number[32];
+    for (auto &event: events) {
+        separator();
+        ostream << "{\"ph\": \"" << event.phase << "\", \"name\": " << json_string(event.name);
+        std::snprintf(number, sizeof number, "%.3f", event.time);
+        ostream << ", \"pid\": 1, \"tid\": " << event.tid << ", \"ts\": " << number;
+        if (event.phase == 'X') {
+            std::snprintf(number, sizeof number, "%.3f", event.duration);
+            ostream << ", \"dur\": " << number;
+        } else {
+            // counters are per process, the id keeps the series of the threads apart
+            ostream << ", \"id\": " << event.tid / TRACKS_PER_THREAD;
+        }
+        ostream << ", \"args\": {" << event.args << "}}";
+    }
+    ostream << std::endl << "]}" << std::endl;
+}
+
+Recorder *active() {
+    return active_recorder.load(std::memory_order_relaxed);
+}
+
+void set_active(Recorder *recorder) {
+    active_recorder.store(recorder, std::memory_order_relaxed);
+}
+
+void Span::begin(const char *span_name, const Compiler *span_compiler) {
+    name = span_name;
+    compiler = span_compiler;
+    if (compiler)
+        counters_start = compiler->trace_counters();
+    heap_start = memstats::thread_current();
+    start = recorder->now();
+}
+
+void Span::end() {
+    double finish = recorder->now();
+    auto heap = memstats::thread_current();
+    std::string span_args = heap_args({heap.allocations - heap_start.allocations,
+                                       heap.allocated_bytes - heap_start.allocated_bytes});
+    if (compiler) {
+        auto counters = compiler->trace_counters();
+        span_args += ", " + counter_args({counters.tokens - counters_start.tokens,
+                                          counters.reductions - counters_start.reductions,
+                                          counters.instructions - counters_start.instructions,
+                                          counters.symbol_lookups - counters_start.symbol_lookups});
+        recorder->counter("compiler", finish, counter_args(counters));
+    }
+    span_args += args;
+    recorder->complete(name, start, finish - start, std::move(span_args));
+    recorder->counter("heap", finish, heap_args(heap));
+}
+
+void Span::add_arg(std::string_view key, std::string_view value) {
+    args += ", " + json_string(key) + ": " + json_string(value);
+}
+
+void ParseTrace::begin() {
+    recorder = active();
+    if (!recorder)
+        return;
+    current = Phase::PARSE;
+    start = last = recorder->now();
+    heap_last = memstats::thread_current();
+}
+
+void ParseTrace::switch_to(Phase phase) {
+    double time_now = recorder->now();
+    auto heap_now = memstats::thread_current();
+    int index = int(current);
+    time[index] += time_now - last;
+    heap[index].allocations += heap_now.allocations - heap_last.allocations;
+    heap[index].allocated_bytes += heap_now.allocated_bytes - heap_last.allocated_bytes;
+    last = time_now;
+    heap_last = heap_now;
+    current = phase;
+}
+
+void ParseTrace::end() {
+    if (!recorder)
+        return;
+    switch_to(Phase::NONE);
+    static const char *const names[] = {"scanner", "parser", "codegen"};
+    double time_at = start;
+    for (int phase = 0; phase < int(Phase::NONE); phase++) {
+        std::string args = heap_args(heap[phase]);
+        if (phase == int(Phase::SCAN))
+            append_number(args, "tokens", tokens);
+        else if (phase == int(Phase::CODEGEN))
+            append_number(args, "reductions", reductions);
+        recorder->complete(names[phase], time_at, time[phase], std::move(args), 1);
+        time_at += time[phase];
+    }
+    recorder = nullptr;
+}
+
+}
@@ -0,0 +1,158 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MemStats.hpp"
+
+class Compiler;
+
+/// @brief Recording of compile phases in the Chrome trace event format, viewable in
+/// chrome://tracing or ui.perfetto.dev. Every probe first checks the active recorder, so with
+/// tracing disabled a span costs one load and a not taken branch.
+namespace trace {
+
+/// @brief Growing counts of one compilation, their growth during a span ends up in its arguments
+struct Counters {
+    uint64_t tokens = 0;
+    uint64_t reductions = 0;
+    uint64_t instructions = 0;   // emitted by code generation, before optimization
+    uint64_t symbol_lookups = 0; // keyed lookups in the symbol table
+};
+
+/// @brief Collects the events of all threads, written out once compilation finished
+class Recorder {
+public:
+    Recorder();
+
+    /// @return microseconds since the recorder was created
+    double now() const;
+
+    /// @brief Adds a complete ("X") event of the calling thread
+    /// @param args body of the JSON arguments object, may be empty
+    /// @param track 0 for the thread itself, other values give the thread additional rows
+    void complete(std::string_view name, double start, double duration, std::string args, int track = 0);
+
+    /// @brief Adds a counter ("C") event, one series per thread
+    void counter(std::string_view name, double time, std::string args);
+
+    void write(std::ostream &ostream) const;
+
+private:
+    struct Event {
+        char phase;
+        std::string name;
+        int tid;
+        double time;
+        double duration;
+        std::string args;
+    };
+
+    /// @return small number identifying the calling thread in this trace
+    int thread_id();
+
+    std::chrono::steady_clock::time_point start;
+    mutable std::mutex mutex;
+    std::vector<Event> events;
+    std::vector<int> tids;
+};
+
+/// @return recorder set by --trace, null when tracing is disabled
+Recorder *active();
+
+void set_active(Recorder *recorder);
+
+/// @brief Records the lifetime of the object as a span with the heap allocations of the thread
+/// and, when given a compiler, the growth of its counters as arguments
+class Span {
+public:
+    explicit Span(const char *name, const Compiler *compiler = nullptr) : recorder(active()) {
+        if (recorder)
+            begin(name, compiler);
+    }
+
+    ~Span() {
+        if (recorder)
+            end();
+    }
+
+    Span(const Span &) = delete;
+
+    Span &operator=(const Span &) = delete;
+
+    /// @brief Adds a string argument to the span
+    void arg(std::string_view key, std::string_view value) {
+        if (recorder)
+            add_arg(key, value);
+    }
+
+private:
+    void begin(const char *name, const Compiler *compiler);
+
+    void end();
+
+    void add_arg(std::string_view key, std::string_view value);
+
+    Recorder *recorder;
+    const char *name = nullptr;
+    const Compiler *compiler = nullptr;
+    double start = 0;
+    memstats::Counters heap_start;
+    Counters counters_start;
+    std::string args;
+};
+
+/// @brief Token and reduction counts of a parse and the split of its time between the scanner,
+/// the parser and the semantic actions generating code. The three alternate at every token, so
+/// their times are summed up and recorded at the end of the parse, one span each on a second
+/// row of the thread.
+class ParseTrace {
+public:
+    enum class Phase {
+        SCAN,
+        PARSE,   // shifts and table lookups
+        CODEGEN, // semantic actions, from a reduction until the parser asks for the next token
+        NONE,    // work with its own spans, e.g. streamed statements being optimized and written
+        COUNT,
+    };
+
+    /// @brief Starts timing when tracing is enabled
+    void begin();
+
+    /// @brief Records the summed up phases, started at the begin() time
+    void end();
+
+    void enter(Phase phase) {
+        if (recorder)
+            switch_to(phase);
+    }
+
+    /// @brief Counts a reduction of the parser, its semantic action runs as code generation
+    void reduce() {
+        reductions++;
+        enter(Phase::CODEGEN);
+    }
+
+public:
+    uint64_t tokens = 0;
+    uint64_t reductions = 0;
+
+private:
+    void switch_to(Phase phase);
+
+    static constexpr int PHASE_COUNT = int(Phase::COUNT);
+
+    Recorder *recorder = nullptr;
+    Phase current = Phase::PARSE;
+    double start = 0;
+    double last = 0;
+    memstats::Counters heap_last;
+    double time[PHASE_COUNT] = {};
+    memstats::Counters heap[PHASE_COUNT] = {};
+};
+
+}
@@ -0,0 +1,225 @@
+#include "ValueNumbering.hpp"
+#include "LoopInfo.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace passes {
+
+namespace {
+
+std::string base_symbol(const std::string &symbol) {
+    return symbol.substr(0, symbol.find('+'));
+}
+
+/// @return true if recomputing the value costs more than a copy of a register kept for it:
+/// loads, multiplications and divisions, and addresses of memory accesses
+bool worth_keeping(const std::vector<ir::Instr> &instrs, std::size_t idx) {
+    auto &instr = instrs[idx];
+    if (instr.is_load() || instr.opcode == "mul" || instr.opcode == "div" || instr.opcode == "mul.s"
+        || instr.opcode == "div.s")
+        return true;
+    const std::string &def = instr.operands[0].text;
+    for (std::size_t j = idx + 1; j < instrs.size(); j++) {
+        for (auto &op: instrs[j].operands) {
+            if (op.is_mem() && op.text == def)
+                return true;
+        }
+        auto defs = instrs[j].defs();
+        if (std::find(defs.begin(), defs.end(), def) != defs.end())
+            return false;
+    }
+    return false;
+}
+
+/// @brief Value numbers of the registers and of the memory loaded so far in one block
+class BlockValues {
+public:
+    BlockValues(std::vector<ir::Instr> &instrs, const std::set<std::string> &address_taken, ir::RegSet taken)
+        : instrs(instrs), address_taken(address_taken), taken(taken) {}
+
+    /// @brief Numbers instruction idx, rewriting it to a copy if a register holds its value. When
+    /// the register computing it first was overwritten since, that computation is moved to a
+    /// register free in the whole block if there is one and the value is worth keeping.
+    /// @return true if the instruction was rewritten, idx is moved past copies inserted before it
+    bool visit(std::size_t &idx) {
+        auto &instr = instrs[idx];
+        auto kind = instr.info().kind;
+        if (instr.is_store()) {
+            store(instr);
+            return false;
+        }
+        if (kind != ir::OpInfo::Kind::ARITHMETIC && !instr.is_load()) {
+            for (auto &def: instr.defs())
+                reg_values[def] = fresh();
+            return false;
+        }
+
+        bool copy = ir::is_copy(instr.opcode);
+        int value;
+        if (copy) {
+            value = value_of(instr.operands[1].text);
+        } else {
+            std::string key = instr.is_load() ? load_key(instr.opcode, instr.operands[1]) : expression_key(instr);
+            auto &table = instr.is_load() ? memory : expressions;
+            auto found = table.find(key);
+            value = found == table.end() ? (table[key] = fresh()) : found->second;
+        }
+
+        auto defs = instr.defs();
+        if (defs.size() != 1)
+            return false;
+        const std::string def = defs[0];
+        if (copy) {
+            reg_values[def] = value;
+            return false;
+        }
+
+        auto holder = holder_of(value, def);
+        auto producer = producers.find(value);
+        if (holder.empty() && producer != producers.end() && instrs[producer->second].info().def_operand == 0
+            && worth_keeping(instrs, idx)) {
+            holder = keep_in_free_register(producer->second, value, def[1] == 'f');
+            if (!holder.empty())
+                idx++;
+        }
+        if (holder.empty()) {
+            producers[value] = idx;
+            reg_values[def] = value;
+            return false;
+        }
+        instrs[idx] = ir::Instr(def[1] == 'f' ? "mov.s" : "move", {def, holder});
+        reg_values[def] = value;
+        return true;
+    }
+
+private:
+    int fresh() { return next_value++; }
+
+    int value_of(const std::string &reg) {
+        auto found = reg_values.find(reg);
+        if (found != reg_values.end())
+            return found->second;
+        return reg_values[reg] = fresh(); // whatever the register held on block entry
+    }
+
+    /// @return a register holding the value, empty if none does. The registers a syscall reads
+    /// are only used when they are def itself: a copy from one would let later passes drop the
+    /// setup the syscall needs.
+    std::string holder_of(int value, const std::string &def) const {
+        for (auto &[reg, held]: reg_values) {
+            if (held == value && (reg == def || (reg != "$v0" && reg != "$a0" && reg != "$f12")))
+                return reg;
+        }
+        return {};
+    }
+
+    std::string operand_key(const ir::Operand &op) {
+        if (op.is_reg() || op.is_mem())
+            return (op.is_mem() ? "(v" : "v") + std::to_string(value_of(op.text));
+        return op.text;
+    }
+
+    std::string expression_key(const ir::Instr &instr) {
+        int def_operand = instr.info().def_operand;
+        std::vector<std::string> operands;
+        for (int k = 0; k < int(instr.operands.size()); k++) {
+            if (k != def_operand)
+                operands.push_back(operand_key(instr.operands[k]));
+        }
+        if (ir::is_commutative(instr.opcode))
+            std::sort(operands.begin(), operands.end());
+        std::string key = instr.opcode;
+        for (auto &op: operands)
+            key += " " + op;
+        return key;
+    }
+
+    std::string load_key(const std::string &load_opcode, const ir::Operand &address) {
+        return load_opcode + " " + operand_key(address);
+    }
+
+    /// @brief Forgets the loads the store may overwrite, then remembers the stored value
+    void store(const ir::Instr &instr) {
+        auto &address = instr.operands[1];
+        // a named store may write what an indirect load reads, an indirect one what a named
+        // load of an array or address-taken variable reads
+        for (auto it = memory.begin(); it != memory.end();) {
+            auto space = it->first.find(' ');
+            bool indirect = it->first.compare(space + 1, 2, "(v") == 0;
+            bool clobbered;
+            if (address.is_symbol()) {
+                clobbered = indirect || base_symbol(it->first.substr(space + 1)) == base_symbol(address.text);
+            } else {
+                auto symbol = it->first.substr(space + 1);
+                clobbered = indirect || symbol.find('+') != std::string::npos
+                            || address_taken.count(base_symbol(symbol)) != 0;
+            }
+            it = clobbered ? memory.erase(it) : std::next(it);
+        }
+        const char *load_opcode = instr.opcode == "s.s" ? "l.s" : "lw";
+        memory[load_key(load_opcode, address)] = value_of(instr.operands[0].text);
+    }
+
+    /// @brief Makes the instruction at producer write a free register, copied to its original
+    /// destination right after it
+    /// @return the free register, empty if there is none
+    std::string keep_in_free_register(std::size_t producer, int value, bool is_float) {
+        std::string reg;
+        for (int i = is_float ? 31 : 9; i >= 0 && reg.empty(); i--) {
+            std::string candidate = (is_float ? "$f" : "$t") + std::to_string(i);
+            if (!taken.test(ir::reg_bit(candidate)))
+                reg = candidate;
+        }
+        for (int i = 0; i < 8 && reg.empty() && !is_float; i++) {
+            std::string candidate = "$s" + std::to_string(i);
+            if (!taken.test(ir::reg_bit(candidate)))
+                reg = candidate;
+        }
+        if (reg.empty())
+            return {};
+        taken.set(ir::reg_bit(reg));
+
+        auto &instr = instrs[producer];
+        ir::Instr copy(is_float ? "mov.s" : "move", {instr.operands[0], reg});
+        instr.operands[0] = ir::Operand(reg);
+        instrs.insert(instrs.begin() + long(producer) + 1, std::move(copy));
+        for (auto &[value, idx]: producers) {
+            if (idx > producer)
+                idx++;
+        }
+        reg_values[reg] = value;
+        return reg;
+    }
+
+    std::vector<ir::Instr> &instrs;
+    const std::set<std::string> &address_taken;
+    ir::RegSet taken; // registers live into or out of the block or named in it
+    std::map<int, std::size_t> producers; // value number -> instruction computing it
+    std::map<std::string, int> reg_values;  // register -> number of the value it holds
+    std::map<std::string, int> expressions; // opcode and operand numbers -> value number
+    std::map<std::string, int> memory;      // load opcode and address -> value number
+    int next_value = 0;
+};
+
+}
+
+void number_values(ir::Program &program, PassStats &stats) {
+    auto symbols = ir::address_taken_symbols(program);
+    std::set<std::string> address_taken(symbols.begin(), symbols.end());
+    ir::Liveness liveness(program);
+    for (int b = 0; b < int(program.blocks.size()); b++) {
+        auto &instrs = program.blocks[b].instrs;
+        ir::RegSet taken = liveness.live_in(b) | liveness.live_out(b);
+        for (auto &instr: instrs)
+            taken |= ir::reg_set(instr.defs()) | ir::reg_set(instr.uses());
+        BlockValues values(instrs, address_taken, taken);
+        for (std::size_t i = 0; i < instrs.size(); i++) {
+            if (values.visit(i))
+                stats.add("values reused", 1);
+        }
+    }
+}
+
+}
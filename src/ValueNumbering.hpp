@@ -0,0 +1,13 @@
+#pragma once
+#include "Ir.hpp"
+#include "PassManager.hpp"
+
+namespace passes {
+
+/// @brief Local value numbering: within a basic block an arithmetic instruction or a load that
+/// recomputes a value a register still holds becomes a copy of that register, so repeated
+/// subexpressions and array element addresses are computed once. Loads are forgotten when a
+/// store may write their memory and a stored value is remembered as the value of its address.
+void number_values(ir::Program &program, PassStats &stats);
+
+}
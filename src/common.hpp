@@ -11,8 +11,11 @@
 #include <vector>
 #include <stack>
 #include <unordered_map>
+#include <cmath>
+#include <climits>
 
 #include "RegisterManager.hpp"
+#include "Interner.hpp"
 
 
 enum class ExprElemType {
@@ -44,6 +47,20 @@ inline bool VarType_is_num_array(VarType type) {
     return type == VarType::I32_ARR || type == VarType::F32_ARR;
 }
 
+/// @return shortest decimal text which reads back as exactly the same f32 value
+inline std::string format_f32(float value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    return buf;
+}
+
+/// @brief f32 to i32 conversion as done by cvt.w.s with the default rounding mode
+inline int32_t f32_to_i32(float value) {
+    if (std::isnan(value) || value >= 2147483648.0f || value < -2147483648.0f)
+        return INT32_MAX;
+    return static_cast<int32_t>(std::nearbyint(value));
+}
+
 enum class CondExprOp {
     EQ,
     NEQ,
@@ -54,13 +71,13 @@ enum class CondExprOp {
 };
 
 struct StackEntry {
-    std::string value;
+    Symbol value; // identifier or literal text
     ExprElemType type;
     VarType var_type = VarType::UNDEFINED;
     bool is_arr_elem = false;
 
     int arr_static_idx = -1; // -1 array index has to be calculated in runtime
-    std::vector<int> arr_indices; // -1 indicates element on the stack
+    std::vector<int> arr_indices{}; // -1 indicates element on the stack
 
     std::string get_instr_postfix(bool load_addresses=false) const {
         if (var_type == VarType::U8_ARR || (load_addresses && is_arr_elem))
@@ -75,15 +92,25 @@ struct StackEntry {
     bool is_literal_i32() const {
         return type == ExprElemType::NUMBER && var_type == VarType::I32;
     }
+    bool is_literal_f32() const {
+        return type == ExprElemType::NUMBER && var_type == VarType::F32;
+    }
+    bool is_literal() const {
+        return type == ExprElemType::NUMBER;
+    }
+    float literal_as_f32() const {
+        return var_type == VarType::F32 ? std::stof(value.string()) : static_cast<float>(std::stoi(value.string()));
+    }
 };
 
 struct SymbolInfo {
     VarType type;
     bool temporary = false;
-    std::string initial_value;
+    Symbol initial_value{};
     bool tmp_in_data_region = false; // only for temporary variables
-    std::vector<int> array_dims;
-    std::vector<int> array_sizes;
+    bool unused = false; // the optimized program does not refer to it, left out of the data region
+    std::vector<int> array_dims{};
+    std::vector<int> array_sizes{};
     bool initialized = false;
     Reg occupied_reg{};
 };
@@ -1,25 +1,49 @@
-%{
-#define INFILE_ERROR 1
-#define OUTFILE_ERROR 2
+%code requires {
+#include "Compiler.hpp"
 
-#include "../src/Compiler.hpp" // TODO: CMAKE modification
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+}
 
-extern "C" int yyparse(void);
-extern "C" int yyerror(const char *, ...);
-extern "C" int yylex(void);
+%code provides {
+int yylex(YYSTYPE *yylval, yyscan_t scanner);
+void yyerror(yyscan_t scanner, Compiler &compiler, const char *msg);
+int scanner_line(yyscan_t scanner);
+}
 
-Compiler compiler;
+%code {
+// Every semantic action starts with it, the parse trace counts the reduction and times the
+// action as code generation
+#define REDUCED compiler.parse_trace.reduce()
 
+/// @brief Token source of the parser, counts the tokens and times the scanner
+static int yylex(YYSTYPE *yylval, yyscan_t scanner, Compiler &compiler) {
+    compiler.parse_trace.enter(trace::ParseTrace::Phase::SCAN);
+    int token = yylex(yylval, scanner);
+    compiler.parse_trace.enter(trace::ParseTrace::Phase::PARSE);
+    compiler.parse_trace.tokens += token != 0;
+    return token;
+}
+}
+
+%{
+#define INFILE_ERROR 1
+#define OUTFILE_ERROR 2
 %}
+%define api.pure full
+%parse-param {yyscan_t scanner} {Compiler &compiler}
+%lex-param {yyscan_t scanner} {Compiler &compiler}
 %union 
-{char *text;
+{unsigned sym;
 int	ival;
 float fval;};
-%type <text> wyr
-%token <text> ID
+%type <sym> wyr
+%token <sym> ID
 %token <ival> KINT
 %token <fval> KFLOAT
-%token <text> STRING
+%token <sym> STRING
 %token U0 U8 I32 F32
 %token KRETURN KIF KELSE KFOR
 %token GEQ LEQ EQ NEQ
@@ -29,120 +53,105 @@ float fval;};
 %%
 
 stmt_list
-    : stmt {;}
-    | stmt_list stmt {;}
+    : stmt {REDUCED; compiler.end_statement();}
+    | stmt_list stmt {REDUCED; compiler.end_statement();}
     ;
 
 stmt
-    : variable_decl ';' {;}
-    | assignment ';' {compiler.gen_assignment();}
-    | KPRINT_I32 '(' wyr ')' ';' {compiler.gen_print(VarType::I32);}
-    | KPRINT_F32 '(' wyr ')' ';' {compiler.gen_print(VarType::F32);}
-    | KPRINT_STRING '(' wyr ')' ';' {compiler.gen_print(VarType::U8_ARR);}
-    | if_expr {;}
-    | for_expr {;}
+    : variable_decl ';' {REDUCED;}
+    | assignment ';' {REDUCED; compiler.gen_assignment();}
+    | KPRINT_I32 '(' wyr ')' ';' {REDUCED; compiler.gen_print(VarType::I32);}
+    | KPRINT_F32 '(' wyr ')' ';' {REDUCED; compiler.gen_print(VarType::F32);}
+    | KPRINT_STRING '(' wyr ')' ';' {REDUCED; compiler.gen_print(VarType::U8_ARR);}
+    | if_expr {REDUCED;}
+    | for_expr {REDUCED;}
     ;
 
 code_block
-    : stmt ';' {;}
-    | '{' stmt_list '}' {;}
+    : stmt ';' {REDUCED;}
+    | '{' stmt_list '}' {REDUCED;}
     ;
 
 wyr
-	:wyr '+' skladnik	{compiler.gen_arithmetic('+');}
-	|wyr '-' skladnik	{compiler.gen_arithmetic('-');}
-	|skladnik		{; /*printf("B: wyrazenie pojedyncze \n"); */ }
+	:wyr '+' skladnik	{REDUCED; compiler.gen_arithmetic('+');}
+	|wyr '-' skladnik	{REDUCED; compiler.gen_arithmetic('-');}
+	|skladnik		{REDUCED; /*printf("B: wyrazenie pojedyncze \n"); */ }
 	;
 
 variable_decl
-    :I32 assignment {compiler.gen_declare(VarType::I32);}
-    |F32 assignment {compiler.gen_declare(VarType::F32);}
-    |U8 ID '[' ']' '=' wyr { compiler.stack.push_id($2, true); compiler.gen_declare(VarType::U8_ARR); }
-    |I32 ID {compiler.gen_declare(VarType::I32, $2);}
-    |F32 ID {compiler.gen_declare(VarType::F32, $2);}
-    |I32 ID dim_decl {compiler.gen_declare(VarType::I32_ARR, $2);}
-    |F32 ID dim_decl {compiler.gen_declare(VarType::F32_ARR, $2);}
+    :I32 assignment {REDUCED; compiler.gen_declare(VarType::I32);}
+    |F32 assignment {REDUCED; compiler.gen_declare(VarType::F32);}
+    |U8 ID '[' ']' '=' wyr {REDUCED; compiler.stack.push_id(compiler.interner.get($2), true); compiler.gen_declare(VarType::U8_ARR); }
+    |I32 ID {REDUCED; compiler.gen_declare(VarType::I32, compiler.interner.get($2));}
+    |F32 ID {REDUCED; compiler.gen_declare(VarType::F32, compiler.interner.get($2));}
+    |I32 ID dim_decl {REDUCED; compiler.gen_declare(VarType::I32_ARR, compiler.interner.get($2));}
+    |F32 ID dim_decl {REDUCED; compiler.gen_declare(VarType::F32_ARR, compiler.interner.get($2));}
     ;
 dim_decl
-    : '[' size_const ']' {;}
+    : '[' size_const ']' {REDUCED;}
     ;
 size_const
-    : size_const ',' static_size_value {;}
-    | static_size_value {;}
+    : size_const ',' static_size_value {REDUCED;}
+    | static_size_value {REDUCED;}
     ;
 static_size_value
-    : KINT { compiler.static_array_dims.push($1); }
+    : KINT {REDUCED; compiler.static_array_dims.push($1); }
     ;
 assignment
-    :ID '=' wyr         { compiler.stack.push_id($1, true); }
-    |ID arr_idx '=' wyr { compiler.stack.push_id($1); compiler.gen_calc_arr_addr(false); }
+    :ID '=' wyr         {REDUCED; compiler.stack.push_id(compiler.interner.get($1), true); }
+    |ID arr_idx '=' wyr {REDUCED; compiler.stack.push_id(compiler.interner.get($1)); compiler.gen_calc_arr_addr(false); }
     ;
 if_expr
-	:if_begin code_block { compiler.gen_if_end(); }
-	|if_begin code_block else_begin code_block { compiler.gen_if_end(); }
+	:if_begin code_block {REDUCED; compiler.gen_if_end(); }
+	|if_begin code_block else_begin code_block {REDUCED; compiler.gen_if_end(); }
 	;
 if_begin
-    :KIF '(' cond_expr ')' {compiler.gen_if_begin();}
+    :KIF '(' cond_expr ')' {REDUCED; compiler.gen_if_begin();}
     ;
 else_begin
-    :KELSE { compiler.gen_else(); }
+    :KELSE {REDUCED; compiler.gen_else(); }
     ;
 for_expr
-    :for_begin code_block { compiler.gen_for_end(); }
+    :for_begin code_block {REDUCED; compiler.gen_for_end(); }
     ;
 for_begin
-    :KFOR '(' for_cond ')' { compiler.gen_for_begin(); }
+    :KFOR '(' for_cond ')' {REDUCED; compiler.gen_for_begin(); }
     ;
 for_cond
-    :I32 ID ':' wyr DOTDOT wyr {compiler.set_for_conditions($2, false);}
-    |I32 ID ':' wyr DOTDOTEQ wyr {compiler.set_for_conditions($2, true);}
-    |I32 ID ':' wyr DOTDOT wyr ':' KINT {compiler.set_for_conditions($2, false, $8);}
-    |I32 ID ':' wyr DOTDOTEQ wyr ':' KINT {compiler.set_for_conditions($2, true, $8);}
+    :I32 ID ':' wyr DOTDOT wyr {REDUCED; compiler.set_for_conditions(compiler.interner.get($2), false);}
+    |I32 ID ':' wyr DOTDOTEQ wyr {REDUCED; compiler.set_for_conditions(compiler.interner.get($2), true);}
+    |I32 ID ':' wyr DOTDOT wyr ':' KINT {REDUCED; compiler.set_for_conditions(compiler.interner.get($2), false, $8);}
+    |I32 ID ':' wyr DOTDOTEQ wyr ':' KINT {REDUCED; compiler.set_for_conditions(compiler.interner.get($2), true, $8);}
     ;
 cond_expr
-    : wyr EQ wyr  { compiler.set_cond_expr_op(CondExprOp::EQ ) ;};
-    | wyr NEQ wyr { compiler.set_cond_expr_op(CondExprOp::NEQ) ;};
-    | wyr '<' wyr { compiler.set_cond_expr_op(CondExprOp::LT ) ;};
-    | wyr LEQ wyr { compiler.set_cond_expr_op(CondExprOp::LEQ) ;};
-    | wyr '>' wyr { compiler.set_cond_expr_op(CondExprOp::GT ) ;};
-    | wyr GEQ wyr { compiler.set_cond_expr_op(CondExprOp::EQ ) ;};
+    : wyr EQ wyr  {REDUCED; compiler.set_cond_expr_op(CondExprOp::EQ ) ;};
+    | wyr NEQ wyr {REDUCED; compiler.set_cond_expr_op(CondExprOp::NEQ) ;};
+    | wyr '<' wyr {REDUCED; compiler.set_cond_expr_op(CondExprOp::LT ) ;};
+    | wyr LEQ wyr {REDUCED; compiler.set_cond_expr_op(CondExprOp::LEQ) ;};
+    | wyr '>' wyr {REDUCED; compiler.set_cond_expr_op(CondExprOp::GT ) ;};
+    | wyr GEQ wyr {REDUCED; compiler.set_cond_expr_op(CondExprOp::EQ ) ;};
     ;
 skladnik
-	:skladnik '*' czynnik	{compiler.gen_arithmetic('*');}
-	|skladnik '/' czynnik	{compiler.gen_arithmetic('/');}
-	|czynnik		{;}
+	:skladnik '*' czynnik	{REDUCED; compiler.gen_arithmetic('*');}
+	|skladnik '/' czynnik	{REDUCED; compiler.gen_arithmetic('/');}
+	|czynnik		{REDUCED;}
 	;
 czynnik
-	:ID			{compiler.stack.push_id($1);}
-	|STRING     {compiler.stack.push(ExprElemType::STRING_LITERAL, $1);}
-	|KINT		{compiler.stack.push($1);}
-	|KFLOAT     {compiler.stack.push($1);}
-	|ID arr_idx {compiler.stack.push_id($1); compiler.gen_calc_arr_addr(true);}
-	|'(' wyr ')'		{printf("B: wyrazenie w nawiasach\n");}
+	:ID			{REDUCED; compiler.stack.push_id(compiler.interner.get($1));}
+	|STRING     {REDUCED; compiler.stack.push(ExprElemType::STRING_LITERAL, compiler.interner.get($1));}
+	|KINT		{REDUCED; compiler.stack.push($1);}
+	|KFLOAT     {REDUCED; compiler.stack.push($1);}
+	|ID arr_idx {REDUCED; compiler.stack.push_id(compiler.interner.get($1)); compiler.gen_calc_arr_addr(true);}
+	|'(' wyr ')'		{REDUCED;}
 	;
 arr_idx
-    : '[' arr_dim_idx ']' {;}
+    : '[' arr_dim_idx ']' {REDUCED;}
     ;
 arr_dim_idx
-    : arr_dim_idx ',' wyr { compiler.add_idx_to_arr_idx_stack();}
-    | wyr { compiler.add_idx_to_arr_idx_stack();}
+    : arr_dim_idx ',' wyr {REDUCED; compiler.add_idx_to_arr_idx_stack();}
+    | wyr {REDUCED; compiler.add_idx_to_arr_idx_stack();}
     ;
 %%
-int main(int argc, char **argv) {
-    yyparse();
-
-    if (argc <= 1){
-        compiler.write_data_region(std::cout);
-        compiler.write_text_region(std::cout);
-    } else {
-        std::ofstream outfile(argv[1]);
-        if (!outfile.is_open()) {
-            std::cerr << "Error opening output file: " << argv[1] << std::endl;
-            return 1;
-        }
-        compiler.write_data_region(outfile);
-        compiler.write_text_region(outfile);
-    }
-
-    return 0;
+void yyerror(yyscan_t scanner, Compiler &, const char *msg) {
+    throw std::runtime_error(std::to_string(scanner_line(scanner)) + ": " + msg);
 }
@@ -0,0 +1,5 @@
+#include "Driver.hpp"
+
+int main(int argc, char **argv) {
+    return run_driver(argc, argv);
+}
@@ -0,0 +1,56 @@
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include "MipsSim.hpp"
+
+int main(int argc, char **argv) {
+    bool print_stats = false;
+    const char *path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        if (arg == "--stats") {
+            print_stats = true;
+        } else if (arg[0] == '-' && arg.size() > 1) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    MipsSim sim;
+    try {
+        if (path == nullptr || std::string_view(path) == "-") {
+            sim.load(std::cin);
+        } else {
+            std::ifstream file(path);
+            if (!file.is_open()) {
+                std::cerr << "Error opening input file: " << path << std::endl;
+                return 1;
+            }
+            sim.load(file);
+        }
+        sim.run(std::cout);
+    } catch (const std::exception &e) {
+        std::cout.flush();
+        std::cerr << "mips-sim: " << e.what() << std::endl;
+        return 2;
+    }
+    std::cout.flush();
+
+    if (print_stats) {
+        auto &stats = sim.stats();
+        std::cerr << "text instructions:    " << sim.text_size() << std::endl
+                << "data bytes:           " << sim.data_size() << std::endl
+                << "instructions:         " << stats.instructions << std::endl
+                << "loads:                " << stats.loads << std::endl
+                << "stores:               " << stats.stores << std::endl
+                << "branches:             " << stats.branches << std::endl
+                << "branches taken:       " << stats.branches_taken << std::endl
+                << "syscalls:             " << stats.syscalls << std::endl
+                << "estimated cycles:     " << stats.cycles << std::endl;
+    }
+    return 0;
+}